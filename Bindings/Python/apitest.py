@@ -102,6 +102,9 @@ if __name__ == "__main__":
       brl.enterTtyMode()
       brl.writeText("The Python bindings for BrlAPI seem to be working.")
 
+      # an empty text leaves the text alone but still applies the rest
+      brl.write(regionBegin=1, regionSize=brl.displaySize[0], text="", cursor=1)
+
       while True:
         key = readKey(
           connection = brl,
@@ -75,6 +75,7 @@ except brlapi.ConnectionError as e:
 ###############################################################################
 
 cimport c_brlapi
+from cpython.buffer cimport PyObject_GetBuffer, PyBuffer_Release, PyBUF_SIMPLE
 import errno
 include "constants.auto.pyx"
 
@@ -132,16 +133,39 @@ class ConnectionError(OperationError):
 		"""Authentication method used"""
 		return self.settings.auth
 
+cdef class BufferReference:
+	"""Holds onto the contiguous memory of an object which supports the buffer protocol (bytes, bytearray, memoryview, array, numpy array, ...) so that it can be handed to libbrlapi without being copied."""
+	cdef Py_buffer view
+	cdef object value
+
+	def __cinit__(self, value):
+		PyObject_GetBuffer(value, &self.view, PyBUF_SIMPLE)
+		self.value = value
+
+	def __dealloc__(self):
+		if self.value is not None:
+			PyBuffer_Release(&self.view)
+
+	def __len__(self):
+		return self.view.len
+
 cdef class WriteStruct:
 	"""Structure containing arguments to be given to Connection.write()
 	See brlapi_writeArguments_t(3).
 	
 	This is DEPRECATED. Use the named parameters of write() instead."""
 	cdef c_brlapi.brlapi_writeArguments_t props
+	cdef BufferReference textBuffer
+	cdef BufferReference andMaskBuffer
+	cdef BufferReference orMaskBuffer
 
 	def __init__(self):
 		self.props = c_brlapi.brlapi_writeArguments_initialized
 
+	def __dealloc__(self):
+		if (self.props.charset):
+			c_brlapi.free(self.props.charset)
+
 	property displayNumber:
 		"""Display number DISPLAY_DEFAULT == unspecified"""
 		def __get__(self):
@@ -164,29 +188,28 @@ cdef class WriteStruct:
 			self.props.regionSize = val
 
 	property text:
-		"""Text to display"""
+		"""Text to display; a unicode string, or any buffer (its bytes are used in place, not copied)"""
 		def __get__(self):
-			if (not self.props.text):
+			if (self.textBuffer is None):
 				return None
 			else:
-				return self.props.text
+				return self.textBuffer.value
 		def __set__(self, val):
-			cdef c_brlapi.size_t size
-			cdef char *c_val
 			if (type(val) == unicode):
 				val = val.encode('UTF-8')
-				self.charset = 'UTF-8'.encode("ASCII")
-			if (self.props.text):
-				c_brlapi.free(self.props.text)
-			if (val):
-				size = len(val)
-				c_val = val
-				self.props.text = <char*>c_brlapi.malloc(size+1)
-				c_brlapi.memcpy(<void*>self.props.text,<void*>c_val,size)
-				self.props.text[size] = 0
-				self.props.textSize = size
-			else:
-				self.props.text = NULL
+				# the server only accepts a charset along with some text
+				if (len(val)):
+					self.charset = 'UTF-8'.encode("ASCII")
+			self.textBuffer = None
+			self.props.text = NULL
+			self.props.textSize = -1
+			if (val is not None):
+				self.textBuffer = BufferReference(val)
+				if (len(self.textBuffer)):
+					self.props.text = <char*>self.textBuffer.view.buf
+					self.props.textSize = len(self.textBuffer)
+				else:
+					self.textBuffer = None
 
 	property cursor:
 		"""CURSOR_LEAVE == don't touch, CURSOR_OFF == turn off, 1 = 1st char of display, ..."""
@@ -219,50 +242,42 @@ cdef class WriteStruct:
 				self.props.charset = NULL
 
 	property attrAnd:
-		"""And attributes; applied first"""
+		"""And attributes; applied first; any buffer (its bytes are used in place, not copied), or a latin1 string"""
 		def __get__(self):
-			if (not self.props.andMask):
+			if (self.andMaskBuffer is None):
 				return None
 			else:
-				return <char*>self.props.andMask
+				return self.andMaskBuffer.value
 		def __set__(self, val):
-			cdef c_brlapi.size_t size
-			cdef char *c_val
-			if (self.props.andMask):
-				c_brlapi.free(self.props.andMask)
-			if (val):
-				if (type(val) == unicode):
-					val = val.encode('latin1')
-				size = len(val)
-				c_val = val
-				self.props.andMask = <unsigned char*>c_brlapi.malloc(size+1)
-				c_brlapi.memcpy(<void*>self.props.andMask,<void*>c_val,size)
-				self.props.andMask[size] = 0
-			else:
-				self.props.andMask = NULL
+			if (type(val) == unicode):
+				val = val.encode('latin1')
+			self.andMaskBuffer = None
+			self.props.andMask = NULL
+			if (val is not None):
+				self.andMaskBuffer = BufferReference(val)
+				if (len(self.andMaskBuffer)):
+					self.props.andMask = <unsigned char*>self.andMaskBuffer.view.buf
+				else:
+					self.andMaskBuffer = None
 
 	property attrOr:
-		"""Or attributes; applied after ANDing"""
+		"""Or attributes; applied after ANDing; any buffer (its bytes are used in place, not copied), or a latin1 string"""
 		def __get__(self):
-			if (not self.props.orMask):
+			if (self.orMaskBuffer is None):
 				return None
 			else:
-				return <char*>self.props.orMask
+				return self.orMaskBuffer.value
 		def __set__(self, val):
-			cdef c_brlapi.size_t size
-			cdef char *c_val
-			if (self.props.orMask):
-				c_brlapi.free(self.props.orMask)
-			if (val):
-				if (type(val) == unicode):
-					val = val.encode('latin1')
-				size = len(val)
-				c_val = val
-				self.props.orMask = <unsigned char*>c_brlapi.malloc(size+1)
-				c_brlapi.memcpy(<void*>self.props.orMask,<void*>c_val,size)
-				self.props.orMask[size] = 0
-			else:
-				self.props.orMask = NULL
+			if (type(val) == unicode):
+				val = val.encode('latin1')
+			self.orMaskBuffer = None
+			self.props.orMask = NULL
+			if (val is not None):
+				self.orMaskBuffer = BufferReference(val)
+				if (len(self.orMaskBuffer)):
+					self.props.orMask = <unsigned char*>self.orMaskBuffer.view.buf
+				else:
+					self.orMaskBuffer = None
 
 cdef class Connection:
 	"""Class which manages the bridge between your program and BrlAPI"""
@@ -460,11 +475,11 @@ cdef class Connection:
 			writeArguments.regionBegin = regionBegin
 		if regionSize != None:
 			writeArguments.regionSize = regionSize
-		if text:
+		if text is not None:
 			writeArguments.text = text
-		if andMask:
+		if andMask is not None:
 			writeArguments.attrAnd = andMask
-		if orMask:
+		if orMask is not None:
 			writeArguments.attrOr = orMask
 		if cursor != None:
 			writeArguments.cursor = cursor
@@ -480,18 +495,22 @@ cdef class Connection:
 	def writeDots(self, dots):
 		"""Write the given dots array to the display.
 		See brlapi_writeDots(3).
-		* dots : points on an array of dot information, one per character. Its size must hence be the same as what displaysize provides."""
+		* dots : points on an array of dot information, one per character. Its size must hence be the same as what displaysize provides. Any buffer (bytes, bytearray, memoryview, numpy array, ...) is used in place, without being copied, unless it's too short and needs to be padded."""
 		cdef int retval
-		cdef char *c_dots
 		cdef unsigned char *c_udots
+		cdef BufferReference dotsBuffer
+		cdef char *c_padded
 		(x, y) = self.displaySize
 		dispSize = x * y
 		if (type(dots) == unicode):
 			dots = dots.encode('latin1')
-		if (len(dots) < dispSize):
-			dots = dots + b"".center(dispSize - len(dots), '\0')
-		c_dots = dots
-		c_udots = <unsigned char *>c_dots
+		dotsBuffer = BufferReference(dots)
+		if (len(dotsBuffer) < dispSize):
+			padded = bytearray(dispSize)
+			c_padded = padded
+			c_brlapi.memcpy(<void*>c_padded, dotsBuffer.view.buf, len(dotsBuffer))
+			dotsBuffer = BufferReference(padded)
+		c_udots = <unsigned char *>dotsBuffer.view.buf
 		with nogil:
 			retval = c_brlapi.brlapi__writeDots(self.h, c_udots)
 		if retval == -1:
@@ -705,3 +724,84 @@ cdef class Connection:
 		else:
 			return retval
 
+cdef class AsyncConnection(Connection):
+	"""A connection for programs which drive many connections from one event loop (asyncio, selectors, ...) rather than blocking in readKey().
+
+	The connection's socket is exposed through fileno(), so it can be registered with a selector, and keys can be awaited:
+
+	  b = brlapi.AsyncConnection()
+	  b.enterTtyMode()
+	  async for key in b:
+	    ...
+
+	or, one at a time, with "key = await b.readKeyAsync()". Keys are only read from the socket when it's readable, so the event loop is never blocked waiting for one."""
+
+	cdef object loop
+	cdef object pendingKey
+
+	def __init__(self, host = None, auth = None, loop = None):
+		"""Connect to BrlAPI as Connection() does. loop is the asyncio event loop to use; it defaults to the current one when a key is first awaited."""
+		Connection.__init__(self, host, auth)
+		self.loop = loop
+		self.pendingKey = None
+
+	def fileno(self):
+		"""Returns the Unix file descriptor that the connection uses, so that the connection itself can be given to select() and selectors"""
+		return self.fd
+
+	def readKeyAsync(self):
+		"""Returns an asyncio future for the next key press (see readKey()). A key which has already arrived resolves it immediately."""
+		import asyncio
+
+		if self.loop is None:
+			self.loop = asyncio.get_event_loop()
+
+		if self.pendingKey is not None:
+			self.loop.remove_reader(self.fd)
+			self.pendingKey.cancel()
+
+		future = self.loop.create_future()
+		self.pendingKey = future
+
+		future.add_done_callback(self._stopWaiting)
+		if not self._deliverKey():
+			self.loop.add_reader(self.fd, self._deliverKey)
+
+		return future
+
+	def _deliverKey(self):
+		future = self.pendingKey
+		if future is None or future.done():
+			return False
+		try:
+			key = self.readKey(False)
+		except OperationError as error:
+			future.set_exception(error)
+			return True
+		if key is None:
+			return False
+		future.set_result(key)
+		return True
+
+	def _stopWaiting(self, future):
+		if self.pendingKey is future:
+			self.pendingKey = None
+			self.loop.remove_reader(self.fd)
+
+	def write(self, *arguments, **keywords):
+		"""See Connection.write(). A key which arrives while waiting for the server to acknowledge the write is queued by libbrlapi rather than left on the socket, so it's delivered here to whoever is awaiting one."""
+		retval = Connection.write(self, *arguments, **keywords)
+		self._deliverKey()
+		return retval
+
+	def writeDots(self, dots):
+		"""See Connection.writeDots()."""
+		retval = Connection.writeDots(self, dots)
+		self._deliverKey()
+		return retval
+
+	def __aiter__(self):
+		return self
+
+	def __anext__(self):
+		return self.readKeyAsync()
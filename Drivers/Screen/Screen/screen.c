@@ -24,12 +24,14 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 #ifdef HAVE_SHMGET
 #include <sys/ipc.h>
 #include <sys/shm.h>
 static key_t shmKey;
-static int shmIdentifier;
+static int shmIdentifier = -1;
 #endif /* HAVE_SHMGET */
 
 #ifdef HAVE_SHM_OPEN
@@ -43,6 +45,8 @@ static int shmFileDescriptor = -1;
 #include "hostcmd.h"
 #include "charset.h"
 #include "ascii.h"
+#include "io_misc.h"
+#include "async_io.h"
 
 #include "scr_driver.h"
 #include "screen.h"
@@ -51,8 +55,306 @@ static unsigned char *shmAddress = NULL;
 static const mode_t shmMode = S_IRWXU;
 static const int shmSize = 4 + ((66 * 132) * 2);
 
+static ScreenImageHeader *imageHeader = NULL;
+static int imageIdentifier = -1;
+
+static struct {
+  uint32_t generation;
+  uint16_t columns;
+  uint16_t rows;
+  uint16_t cursorColumn;
+  uint16_t cursorRow;
+  uint16_t window;
+  uint16_t flags;
+
+  ScreenImageCell *cells;
+  size_t size;
+
+  uint32_t dirtyRows[SCREEN_IMAGE_MAXIMUM_ROWS / 32]; /* not copied yet */
+} image;
+
+static FileDescriptor commandSocket = INVALID_FILE_DESCRIPTOR;
+static AsyncHandle commandMonitor = NULL;
+
+static void
+closeCommandChannel (void) {
+  if (commandMonitor) {
+    asyncCancelRequest(commandMonitor);
+    commandMonitor = NULL;
+  }
+
+  if (commandSocket != INVALID_FILE_DESCRIPTOR) {
+    closeFileDescriptor(commandSocket);
+    commandSocket = INVALID_FILE_DESCRIPTOR;
+  }
+}
+
+static int
+openCommandChannel (const char *path) {
+  struct sockaddr_un address;
+
+  if (strlen(path) >= sizeof(address.sun_path)) {
+    logMessage(LOG_WARNING, "screen command socket path too long: %s", path);
+    return 0;
+  }
+
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, path);
+
+  if ((commandSocket = socket(PF_UNIX, SOCK_STREAM, 0)) != -1) {
+    if (connect(commandSocket, (struct sockaddr *)&address, sizeof(address)) != -1) {
+      logMessage(LOG_INFO, "Screen command socket: %s", path);
+      return 1;
+    } else {
+      logMessage(LOG_WARNING, "cannot connect to screen command socket: %s: %s",
+                 path, strerror(errno));
+    }
+
+    close(commandSocket);
+    commandSocket = INVALID_FILE_DESCRIPTOR;
+  } else {
+    logSystemError("socket");
+  }
+
+  return 0;
+}
+
+static int
+sendScreenCommand (ScreenCommandType type, const char *data, size_t length) {
+  if (commandSocket != INVALID_FILE_DESCRIPTOR) {
+    unsigned char buffer[sizeof(ScreenCommandHeader) + UINT8_MAX];
+    ScreenCommandHeader *header = (ScreenCommandHeader *)buffer;
+    size_t size = sizeof(*header) + length;
+
+    if (length > UINT8_MAX) return 0;
+    header->type = type;
+    header->length = length;
+    header->window = image.window;
+    memcpy(&buffer[sizeof(*header)], data, length);
+
+    if (writeFile(commandSocket, buffer, size) == size) return 1;
+    logSystemError("screen command write");
+    closeCommandChannel();
+  }
+
+  return 0;
+}
+
+ASYNC_MONITOR_CALLBACK(scScreenUpdated) {
+  unsigned char buffer[0X100];
+  ssize_t count = read(commandSocket, buffer, sizeof(buffer));
+
+  if (count > 0) {
+    mainScreenUpdated();
+    return 1;
+  }
+
+  if (count == -1) {
+    if ((errno == EINTR) || (errno == EAGAIN)) return 1;
+    logSystemError("screen command read");
+  } else {
+    logMessage(LOG_WARNING, "screen command channel closed");
+  }
+
+  asyncDiscardHandle(commandMonitor);
+  commandMonitor = NULL;
+  closeFileDescriptor(commandSocket);
+  commandSocket = INVALID_FILE_DESCRIPTOR;
+  return 0;
+}
+
+static int
+poll_ScreenScreen (void) {
+  if (commandSocket == INVALID_FILE_DESCRIPTOR) return 1;
+  if (commandMonitor) return 0;
+  return !asyncMonitorFileInput(&commandMonitor, commandSocket, scScreenUpdated, NULL);
+}
+
+static void
+markImageRows (void) {
+  memset(image.dirtyRows, 0XFF, sizeof(image.dirtyRows));
+}
+
+static int
+refreshImage (void) {
+  ScreenImageHeader *header = imageHeader;
+  int attempts = 3;
+
+  while (1) {
+    uint32_t generation = header->generation;
+    __sync_synchronize();
+
+    if (generation & 1) break;
+    if (generation == image.generation) break;
+
+    {
+      unsigned int index;
+
+      for (index=0; index<ARRAY_COUNT(image.dirtyRows); index+=1) {
+        image.dirtyRows[index] |= __sync_fetch_and_and(&header->dirtyRows[index], 0);
+      }
+    }
+
+    {
+      unsigned int columns = header->columns;
+      unsigned int rows = header->rows;
+      size_t count = columns * rows;
+      __sync_synchronize();
+
+      if ((rows > SCREEN_IMAGE_MAXIMUM_ROWS) || (count > header->cellCount)) {
+        logMessage(LOG_WARNING, "invalid screen image dimensions: %ux%u", columns, rows);
+        return 0;
+      }
+
+      if ((columns != image.columns) || (rows != image.rows)) {
+        if (count > image.size) {
+          ScreenImageCell *cells = realloc(image.cells, ARRAY_SIZE(cells, count));
+
+          if (!cells) {
+            logMallocError();
+            return 0;
+          }
+
+          image.cells = cells;
+          image.size = count;
+        }
+
+        image.columns = columns;
+        image.rows = rows;
+        markImageRows();
+      }
+
+      {
+        const ScreenImageCell *from = (const void *)((const unsigned char *)header + header->headerSize);
+        unsigned int row;
+
+        for (row=0; row<rows; row+=1) {
+          if (image.dirtyRows[row / 32] & (UINT32_C(1) << (row % 32))) {
+            memcpy(&image.cells[row * columns], &from[row * columns],
+                   ARRAY_SIZE(image.cells, columns));
+          }
+        }
+      }
+    }
+
+    image.cursorColumn = header->cursorColumn;
+    image.cursorRow = header->cursorRow;
+    image.window = header->window;
+    image.flags = header->flags;
+    __sync_synchronize();
+
+    if (header->generation == generation) {
+      /* a consistent copy */
+      memset(image.dirtyRows, 0, sizeof(image.dirtyRows));
+      image.generation = generation;
+      break;
+    }
+
+    /* updated while being copied - the rows still to copy remain marked */
+    if (!--attempts) break;
+  }
+
+  return 1;
+}
+
+static int
+refresh_ScreenScreen (void) {
+  if (imageHeader) return refreshImage();
+  return 1;
+}
+
+static void
+detachImage (void) {
+#ifdef HAVE_SHMGET
+  if (imageHeader) {
+    shmdt((void *)imageHeader);
+    imageHeader = NULL;
+  }
+#endif /* HAVE_SHMGET */
+
+  imageIdentifier = -1;
+  closeCommandChannel();
+
+  if (image.cells) {
+    free(image.cells);
+    image.cells = NULL;
+  }
+  image.size = 0;
+}
+
+static int
+attachImage (void) {
+#ifdef HAVE_SHMGET
+  const char *path = getenv("HOME");
+  key_t key;
+
+  if (!path || !*path) path = "/";
+
+  if ((key = ftok(path, SCREEN_IMAGE_PROJECT)) == -1) {
+    logMessage(LOG_DEBUG, "screen image key not generated: %s", strerror(errno));
+    return 0;
+  }
+
+  if ((imageIdentifier = shmget(key, 0, shmMode)) == -1) {
+    logMessage(LOG_DEBUG, "screen image segment 0X%" PRIkey " not accessible: %s",
+               key, strerror(errno));
+    return 0;
+  }
+
+  {
+    struct shmid_ds status;
+
+    if (shmctl(imageIdentifier, IPC_STAT, &status) == -1) {
+      logSystemError("shmctl[IPC_STAT]");
+    } else if (status.shm_segsz < sizeof(*imageHeader)) {
+      logMessage(LOG_WARNING, "screen image segment too small: %lu",
+                 (unsigned long)status.shm_segsz);
+    } else if ((imageHeader = shmat(imageIdentifier, NULL, 0)) == (void *)-1) {
+      logSystemError("shmat");
+      imageHeader = NULL;
+    } else {
+      const ScreenImageHeader *header = imageHeader;
+
+      if (header->magic != SCREEN_IMAGE_MAGIC) {
+        logMessage(LOG_WARNING, "not a screen image: 0X%08" PRIX32, header->magic);
+      } else if (header->version != SCREEN_IMAGE_VERSION) {
+        logMessage(LOG_WARNING, "unsupported screen image version: %u", header->version);
+      } else if ((header->headerSize < sizeof(*header)) ||
+                 (((status.shm_segsz - header->headerSize) / sizeof(ScreenImageCell)) < header->cellCount)) {
+        logMessage(LOG_WARNING, "inconsistent screen image size");
+      } else {
+        char socketPath[sizeof(header->commandSocket) + 1];
+
+        logMessage(LOG_INFO, "Screen image shared memory key: 0X%" PRIkey " (version %u)",
+                   key, header->version);
+
+        memset(&image, 0, sizeof(image));
+        image.generation = 1; /* never seen since it's odd */
+        markImageRows();
+
+        memcpy(socketPath, (const char *)header->commandSocket, sizeof(header->commandSocket));
+        socketPath[sizeof(header->commandSocket)] = 0;
+        if (*socketPath) openCommandChannel(socketPath);
+
+        return 1;
+      }
+    }
+  }
+
+  detachImage();
+#endif /* HAVE_SHMGET */
+
+  return 0;
+}
+
 static int
 construct_ScreenScreen (void) {
+  if (attachImage()) {
+    if (refreshImage()) return 1;
+    detachImage();
+  }
+
 #ifdef HAVE_SHMGET
   {
     key_t keys[2];
@@ -122,6 +424,7 @@ getAuxiliaryData (void) {
 
 static int
 currentVirtualTerminal_ScreenScreen (void) {
+  if (imageHeader) return image.window;
   return getAuxiliaryData()[0];
 }
 
@@ -170,6 +473,15 @@ userVirtualTerminal_ScreenScreen (int number) {
 
 static void
 describe_ScreenScreen (ScreenDescription *description) {
+  if (imageHeader) {
+    description->cols = image.columns;
+    description->rows = image.rows;
+    description->posx = image.cursorColumn;
+    description->posy = image.cursorRow;
+    description->number = image.window;
+    return;
+  }
+
   description->cols = shmAddress[0];
   description->rows = shmAddress[1];
   description->posx = shmAddress[2];
@@ -181,7 +493,27 @@ static int
 readCharacters_ScreenScreen (const ScreenBox *box, ScreenCharacter *buffer) {
   ScreenDescription description;                 /* screen statistics */
   describe_ScreenScreen(&description);
-  if (validateScreenBox(box, description.cols, description.rows)) {
+  if (!validateScreenBox(box, description.cols, description.rows)) return 0;
+
+  if (imageHeader) {
+    ScreenCharacter *character = buffer;
+    int row;
+
+    for (row=0; row<box->height; row++) {
+      const ScreenImageCell *cell = &image.cells[((box->top + row) * image.columns) + box->left];
+      int column;
+
+      for (column=0; column<box->width; column++) {
+        character->text = cell->text;
+        character->attributes = cell->attributes;
+        character++, cell++;
+      }
+    }
+
+    return 1;
+  }
+
+  {
     ScreenCharacter *character = buffer;
     unsigned char *text = shmAddress + 4 + (box->top * description.cols) + box->left;
     unsigned char *attributes = text + (description.cols * description.rows);
@@ -201,7 +533,6 @@ readCharacters_ScreenScreen (const ScreenBox *box, ScreenCharacter *buffer) {
     }
     return 1;
   }
-  return 0;
 }
 
 static int
@@ -213,7 +544,9 @@ insertKey_ScreenScreen (ScreenKey key) {
   wchar_t character = key & SCR_KEY_CHAR_MASK;
 
   if (isSpecialKey(key)) {
-    const unsigned char flags = getAuxiliaryData()[1];
+    const unsigned char flags = imageHeader?
+                                ((image.flags & SCREEN_IMAGE_FLAG_CURSOR_KEYS)? 0X01: 0X00):
+                                getAuxiliaryData()[1];
 
 #define KEY(key,string) case (key): sequence = (string); break
 #define CURSOR_KEY(key,string1,string2) KEY((key), ((flags & 0X01)? (string1): (string2)))
@@ -271,6 +604,18 @@ insertKey_ScreenScreen (ScreenKey key) {
       return 0;
     }
 
+    if (commandSocket != INVALID_FILE_DESCRIPTOR) {
+      /* the command channel takes the bytes as they are */
+      char bytes[2];
+      size_t count = 0;
+
+      if (key & SCR_KEY_ALT_LEFT) bytes[count++] = ESC;
+      bytes[count++] = byte;
+
+      logBytes(LOG_CATEGORY(SCREEN_DRIVER), "insert bytes", bytes, count);
+      if (sendScreenCommand(SCREEN_COMMAND_INSERT, bytes, count)) return 1;
+    }
+
     STR_BEGIN(buffer, sizeof(buffer));
     if (key & SCR_KEY_ALT_LEFT) STR_PRINTF("%c", ESC);
     STR_PRINTF("\\%03o", byte);
@@ -280,14 +625,18 @@ insertKey_ScreenScreen (ScreenKey key) {
   }
 
   logBytes(LOG_CATEGORY(SCREEN_DRIVER), "insert bytes", sequence, strlen(sequence));
+  if (isSpecialKey(key) && sendScreenCommand(SCREEN_COMMAND_INSERT, sequence, strlen(sequence))) return 1;
   return doScreenCommand("stuff", sequence, NULL);
 }
 
 static void
 destruct_ScreenScreen (void) {
+  detachImage();
+
 #ifdef HAVE_SHMGET
   if (shmIdentifier != -1) {
     shmdt(shmAddress);
+    shmIdentifier = -1;
   }
 #endif /* HAVE_SHMGET */
 
@@ -305,6 +654,8 @@ destruct_ScreenScreen (void) {
 static void
 scr_initialize (MainScreen *main) {
   initializeRealScreen(main);
+  main->base.poll = poll_ScreenScreen;
+  main->base.refresh = refresh_ScreenScreen;
   main->base.currentVirtualTerminal = currentVirtualTerminal_ScreenScreen;
   main->base.describe = describe_ScreenScreen;
   main->base.readCharacters = readCharacters_ScreenScreen;
@@ -23,6 +23,69 @@
 extern "C" {
 #endif /* __cplusplus */
 
+/* The versioned screen image which screen maintains (see Patches/screen-image.txt).
+ * It's found via the SysV key ftok($HOME, SCREEN_IMAGE_PROJECT).
+ *
+ * The segment starts with a header, which is followed by the cells.
+ * Cells are stored row by row, the number of columns being the row length.
+ *
+ * The producer updates the image like this:
+ *   generation += 1 (it becomes odd)
+ *   the header fields and the cells are updated
+ *   the bits of the rows which have been changed are set in dirtyRows
+ *   generation += 1 (it becomes even)
+ *   a byte is written to each connection to the command socket
+ *
+ * A consumer atomically fetches and clears the dirty row bits, copies those
+ * rows, and then checks that the generation hasn't changed.
+ */
+
+#define SCREEN_IMAGE_PROJECT 'B'
+#define SCREEN_IMAGE_MAGIC 0X53434D49 /* "SCMI" */
+#define SCREEN_IMAGE_VERSION 2
+#define SCREEN_IMAGE_MAXIMUM_ROWS 256
+
+#define SCREEN_IMAGE_FLAG_CURSOR_KEYS 0X01 /* cursor keys are in application mode */
+#define SCREEN_IMAGE_FLAG_KEYPAD      0X02 /* keypad is in application mode */
+
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t headerSize; /* offset of the cells */
+  uint32_t cellCount; /* number of cells which the segment can hold */
+
+  volatile uint32_t generation; /* odd while being updated */
+  uint16_t columns;
+  uint16_t rows;
+  uint16_t cursorColumn;
+  uint16_t cursorRow;
+  uint16_t window; /* number of the current window */
+  uint16_t flags; /* SCREEN_IMAGE_FLAG_* */
+
+  volatile uint32_t dirtyRows[SCREEN_IMAGE_MAXIMUM_ROWS / 32];
+  char commandSocket[108]; /* path of the command channel */
+} ScreenImageHeader;
+
+typedef struct {
+  uint32_t text; /* UTF-32 */
+  uint32_t attributes; /* VGA: foreground | (background << 4) */
+} ScreenImageCell;
+
+/* A command sent to screen over the command channel (a Unix stream socket).
+ * It's followed by length bytes of data.
+ * The only data screen sends back is one byte per image update.
+ */
+
+typedef enum {
+  SCREEN_COMMAND_INSERT = 1 /* data is input for the window */
+} ScreenCommandType;
+
+typedef struct {
+  uint8_t type; /* SCREEN_COMMAND_* */
+  uint8_t length;
+  uint16_t window;
+} ScreenCommandHeader;
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
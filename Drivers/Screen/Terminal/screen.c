@@ -0,0 +1,1422 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2016 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU General Public License, as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-GPL for details.
+ *
+ * Web Page: http://brltty.com/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+/* This driver runs a shell on a pseudo-terminal and interprets what it writes
+ * (a subset of what a VT102 understands) into its own screen image. Lines which
+ * scroll off the top of the screen are kept, and are presented above it.
+ */
+
+#include "prologue.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+
+#include "log.h"
+#include "parse.h"
+#include "charset.h"
+#include "ascii.h"
+#include "async_io.h"
+
+typedef enum {
+  PARM_COLUMNS,
+  PARM_ROWS,
+  PARM_SCROLLBACK,
+  PARM_SHELL,
+  PARM_TERM
+} ScreenParameters;
+#define SCRPARMS "columns", "rows", "scrollback", "shell", "term"
+
+#include "scr_driver.h"
+
+#define MAXIMUM_PARAMETERS 16
+
+static unsigned int screenColumns;
+static unsigned int screenRows;
+static unsigned int historySize;
+static char *shellCommand = NULL;
+static char *terminalType = NULL;
+
+static ScreenCharacter **screenLines = NULL;
+static ScreenCharacter **historyLines = NULL;
+static unsigned int historyStart;
+static unsigned int historyCount;
+
+static unsigned int cursorColumn;
+static unsigned int cursorRow;
+static unsigned char wrapPending;
+static unsigned char cursorVisible;
+static ScreenAttributes currentAttributes;
+
+typedef struct {
+  unsigned char foreground;
+  unsigned char background;
+  unsigned char bright;
+  unsigned char blink;
+  unsigned char reverse;
+} Rendition;
+
+static Rendition rendition;
+
+static struct {
+  unsigned int column;
+  unsigned int row;
+  Rendition rendition;
+} savedCursor;
+
+static unsigned int scrollTop;
+static unsigned int scrollBottom;
+
+static struct {
+  unsigned char autoWrap:1;
+  unsigned char insert:1;
+  unsigned char cursorKeys:1; /* application mode */
+  unsigned char originRelative:1;
+  unsigned char newLine:1;
+} modes;
+
+typedef enum {
+  PARSE_GROUND,
+  PARSE_ESCAPE,
+  PARSE_DESIGNATE,
+  PARSE_CSI,
+  PARSE_STRING,
+  PARSE_STRING_ESCAPE
+} ParseState;
+
+static ParseState parseState;
+static int parseParameters[MAXIMUM_PARAMETERS];
+static unsigned int parseCount;
+static char parsePrivate;
+
+static int isUtf8;
+static unsigned int utf8Remaining;
+static uint32_t utf8Character;
+
+static int screenChanged;
+
+static pid_t shellProcess = -1;
+static FileDescriptor terminalDescriptor = INVALID_FILE_DESCRIPTOR;
+static AsyncHandle terminalMonitor = NULL;
+
+static struct {
+  /* bytes for the shell which are waiting for the current write to finish */
+  unsigned char *buffer;
+  size_t size;
+  size_t count;
+
+  AsyncHandle writer;
+} terminalInput;
+
+static int
+validateDimension (unsigned int *value, const char *name, const char *parameter, int maximum) {
+  if (*parameter) {
+    static const int minimum = 1;
+    int number;
+
+    if (!validateInteger(&number, parameter, &minimum, &maximum)) {
+      logMessage(LOG_WARNING, "%s: %s", name, parameter);
+      return 0;
+    }
+
+    *value = number;
+  }
+
+  return 1;
+}
+
+static int
+processParameters_TerminalScreen (char **parameters) {
+  screenColumns = 80;
+  validateDimension(&screenColumns, "invalid column count", parameters[PARM_COLUMNS], 0XFF);
+
+  screenRows = 25;
+  validateDimension(&screenRows, "invalid row count", parameters[PARM_ROWS], 0XFF);
+
+  historySize = 1000;
+  if (*parameters[PARM_SCROLLBACK]) {
+    static const int minimum = 0;
+    static const int maximum = 0X7FFF - 0XFF;
+    int lines;
+
+    if (validateInteger(&lines, parameters[PARM_SCROLLBACK], &minimum, &maximum)) {
+      historySize = lines;
+    } else {
+      logMessage(LOG_WARNING, "%s: %s", "invalid scrollback line count", parameters[PARM_SCROLLBACK]);
+    }
+  }
+
+  {
+    const char *shell = parameters[PARM_SHELL];
+
+    if (!*shell) shell = getenv("SHELL");
+    if (!shell || !*shell) shell = "/bin/sh";
+    if (!(shellCommand = strdup(shell))) goto noMemory;
+  }
+
+  {
+    const char *type = parameters[PARM_TERM];
+
+    if (!*type) type = "vt102";
+    if (!(terminalType = strdup(type))) goto noMemory;
+  }
+
+  return 1;
+
+noMemory:
+  logMallocError();
+  return 0;
+}
+
+static void
+releaseParameters_TerminalScreen (void) {
+  if (shellCommand) {
+    free(shellCommand);
+    shellCommand = NULL;
+  }
+
+  if (terminalType) {
+    free(terminalType);
+    terminalType = NULL;
+  }
+}
+
+static void
+updateAttributes (void) {
+  static const unsigned char colours[] = {
+    /* ANSI order: black, red, green, yellow, blue, magenta, cyan, white */
+    0X0, 0X4, 0X2, 0X6, 0X1, 0X5, 0X3, 0X7
+  };
+
+  unsigned char foreground = colours[rendition.foreground];
+  unsigned char background = colours[rendition.background];
+
+  if (rendition.reverse) {
+    unsigned char colour = foreground;
+    foreground = background;
+    background = colour;
+  }
+
+  currentAttributes = foreground | (background << 4);
+  if (rendition.bright) currentAttributes |= SCR_ATTR_FG_BRIGHT;
+  if (rendition.blink) currentAttributes |= SCR_ATTR_BLINK;
+}
+
+static void
+resetRendition (void) {
+  rendition.foreground = 7;
+  rendition.background = 0;
+  rendition.bright = 0;
+  rendition.blink = 0;
+  rendition.reverse = 0;
+  updateAttributes();
+}
+
+static void
+clearCharacters (ScreenCharacter *from, unsigned int count) {
+  const ScreenCharacter *end = from + count;
+
+  while (from < end) {
+    from->text = WC_C(' ');
+    from->attributes = currentAttributes & ~SCR_ATTR_BLINK;
+    from += 1;
+  }
+
+  screenChanged = 1;
+}
+
+static void
+clearLines (unsigned int from, unsigned int to) {
+  while (from < to) clearCharacters(screenLines[from++], screenColumns);
+}
+
+static ScreenCharacter *
+keepLine (ScreenCharacter *line) {
+  /* returns the line to reuse at the bottom of the screen */
+  if (historySize) {
+    if (historyCount < historySize) {
+      ScreenCharacter *newLine;
+
+      if ((newLine = malloc(ARRAY_SIZE(newLine, screenColumns)))) {
+        historyLines[(historyStart + historyCount++) % historySize] = line;
+        return newLine;
+      }
+
+      logMallocError();
+    } else {
+      ScreenCharacter *oldest = historyLines[historyStart];
+
+      historyLines[historyStart] = line;
+      historyStart = (historyStart + 1) % historySize;
+      return oldest;
+    }
+  }
+
+  return line;
+}
+
+static void
+scrollUp (unsigned int top, unsigned int bottom, unsigned int count) {
+  unsigned int size = bottom - top + 1;
+  if (count > size) count = size;
+
+  while (count--) {
+    ScreenCharacter *line = screenLines[top];
+
+    memmove(&screenLines[top], &screenLines[top+1],
+            ARRAY_SIZE(screenLines, (size - 1)));
+
+    if ((top == 0) && (bottom == screenRows - 1)) line = keepLine(line);
+    screenLines[bottom] = line;
+    clearCharacters(line, screenColumns);
+  }
+}
+
+static void
+scrollDown (unsigned int top, unsigned int bottom, unsigned int count) {
+  unsigned int size = bottom - top + 1;
+  if (count > size) count = size;
+
+  while (count--) {
+    ScreenCharacter *line = screenLines[bottom];
+
+    memmove(&screenLines[top+1], &screenLines[top],
+            ARRAY_SIZE(screenLines, (size - 1)));
+
+    screenLines[top] = line;
+    clearCharacters(line, screenColumns);
+  }
+}
+
+static void
+setCursor (int column, int row) {
+  int top = 0;
+  int bottom = screenRows - 1;
+
+  if (modes.originRelative) {
+    top = scrollTop;
+    bottom = scrollBottom;
+    row += top;
+  }
+
+  if (column < 0) column = 0;
+  if (column >= screenColumns) column = screenColumns - 1;
+  if (row < top) row = top;
+  if (row > bottom) row = bottom;
+
+  cursorColumn = column;
+  cursorRow = row;
+  wrapPending = 0;
+  screenChanged = 1;
+}
+
+static void
+moveCursor (int columns, int rows) {
+  int row = cursorRow + rows;
+
+  /* cursor movements don't leave the scrolling region */
+  if ((cursorRow >= scrollTop) && (cursorRow <= scrollBottom)) {
+    if (row < (int)scrollTop) row = scrollTop;
+    if (row > (int)scrollBottom) row = scrollBottom;
+  }
+
+  if (row < 0) row = 0;
+  if (row >= screenRows) row = screenRows - 1;
+
+  {
+    int column = cursorColumn + columns;
+
+    if (column < 0) column = 0;
+    if (column >= screenColumns) column = screenColumns - 1;
+    cursorColumn = column;
+  }
+
+  cursorRow = row;
+  wrapPending = 0;
+  screenChanged = 1;
+}
+
+static void
+lineFeed (void) {
+  if (cursorRow == scrollBottom) {
+    scrollUp(scrollTop, scrollBottom, 1);
+  } else if (cursorRow < (screenRows - 1)) {
+    cursorRow += 1;
+  }
+
+  wrapPending = 0;
+  screenChanged = 1;
+}
+
+static void
+reverseLineFeed (void) {
+  if (cursorRow == scrollTop) {
+    scrollDown(scrollTop, scrollBottom, 1);
+  } else if (cursorRow > 0) {
+    cursorRow -= 1;
+  }
+
+  wrapPending = 0;
+  screenChanged = 1;
+}
+
+static void
+carriageReturn (void) {
+  cursorColumn = 0;
+  wrapPending = 0;
+  screenChanged = 1;
+}
+
+static void
+saveCursor (void) {
+  savedCursor.column = cursorColumn;
+  savedCursor.row = cursorRow;
+  savedCursor.rendition = rendition;
+}
+
+static void
+restoreCursor (void) {
+  cursorColumn = savedCursor.column;
+  cursorRow = savedCursor.row;
+  rendition = savedCursor.rendition;
+  updateAttributes();
+
+  wrapPending = 0;
+  screenChanged = 1;
+}
+
+static void
+resetTerminal (void) {
+  modes.autoWrap = 1;
+  modes.insert = 0;
+  modes.cursorKeys = 0;
+  modes.originRelative = 0;
+  modes.newLine = 0;
+
+  scrollTop = 0;
+  scrollBottom = screenRows - 1;
+  cursorVisible = 1;
+  resetRendition();
+
+  clearLines(0, screenRows);
+  setCursor(0, 0);
+
+  saveCursor();
+
+  parseState = PARSE_GROUND;
+  utf8Remaining = 0;
+}
+
+static void flushTerminalInput (void);
+
+ASYNC_OUTPUT_CALLBACK(tmHandleTerminalInput) {
+  asyncDiscardHandle(terminalInput.writer);
+  terminalInput.writer = NULL;
+
+  if (parameters->error) {
+    logActionError(parameters->error, "pseudo-terminal write");
+    terminalInput.count = 0;
+  } else {
+    flushTerminalInput();
+  }
+}
+
+static void
+flushTerminalInput (void) {
+  /* only one write is outstanding at a time so that it can be cancelled */
+  if (!terminalInput.writer && terminalInput.count) {
+    if (asyncWriteFile(&terminalInput.writer, terminalDescriptor,
+                       terminalInput.buffer, terminalInput.count,
+                       tmHandleTerminalInput, NULL)) {
+      terminalInput.count = 0;
+    }
+  }
+}
+
+static void
+stopTerminalInput (void) {
+  if (terminalInput.writer) {
+    asyncCancelRequest(terminalInput.writer);
+    terminalInput.writer = NULL;
+  }
+
+  if (terminalInput.buffer) {
+    free(terminalInput.buffer);
+    terminalInput.buffer = NULL;
+  }
+
+  terminalInput.size = 0;
+  terminalInput.count = 0;
+}
+
+static void
+writeTerminal (const void *bytes, size_t count) {
+  /* the pseudo-terminal is nonblocking so that a shell which isn't reading
+   * its input can't stall the driver - the bytes are queued instead
+   */
+  if (terminalDescriptor != INVALID_FILE_DESCRIPTOR) {
+    size_t size = terminalInput.count + count;
+
+    if (size > terminalInput.size) {
+      unsigned char *buffer = realloc(terminalInput.buffer, size);
+
+      if (!buffer) {
+        logMallocError();
+        return;
+      }
+
+      terminalInput.buffer = buffer;
+      terminalInput.size = size;
+    }
+
+    memcpy(&terminalInput.buffer[terminalInput.count], bytes, count);
+    terminalInput.count += count;
+    flushTerminalInput();
+  }
+}
+
+static void
+putCharacter (wchar_t character) {
+  ScreenCharacter *line;
+
+  if (wrapPending) {
+    carriageReturn();
+    lineFeed();
+  }
+
+  line = screenLines[cursorRow];
+
+  if (modes.insert) {
+    memmove(&line[cursorColumn+1], &line[cursorColumn],
+            ARRAY_SIZE(line, (screenColumns - cursorColumn - 1)));
+  }
+
+  line[cursorColumn].text = character;
+  line[cursorColumn].attributes = currentAttributes;
+
+  if (cursorColumn < (screenColumns - 1)) {
+    cursorColumn += 1;
+  } else if (modes.autoWrap) {
+    wrapPending = 1;
+  }
+
+  screenChanged = 1;
+}
+
+static int
+getParameter (unsigned int index, int defaultValue) {
+  if (index < parseCount) {
+    int value = parseParameters[index];
+    if (value > 0) return value;
+  }
+
+  return defaultValue;
+}
+
+static void
+setModes (int on) {
+  unsigned int index;
+
+  for (index=0; index<parseCount; index+=1) {
+    int mode = parseParameters[index];
+
+    if (parsePrivate == '?') {
+      switch (mode) {
+        case 1:
+          modes.cursorKeys = on;
+          break;
+
+        case 6:
+          modes.originRelative = on;
+          setCursor(0, 0);
+          break;
+
+        case 7:
+          modes.autoWrap = on;
+          break;
+
+        case 25:
+          cursorVisible = on;
+          screenChanged = 1;
+          break;
+
+        default:
+          logMessage(LOG_CATEGORY(SCREEN_DRIVER), "unsupported private mode: %d", mode);
+          break;
+      }
+    } else if (!parsePrivate) {
+      switch (mode) {
+        case 4:
+          modes.insert = on;
+          break;
+
+        case 20:
+          modes.newLine = on;
+          break;
+
+        default:
+          logMessage(LOG_CATEGORY(SCREEN_DRIVER), "unsupported mode: %d", mode);
+          break;
+      }
+    }
+  }
+}
+
+static void
+selectRendition (void) {
+  unsigned int index = 0;
+
+  if (!parseCount) {
+    resetRendition();
+    return;
+  }
+
+  while (index < parseCount) {
+    int code = parseParameters[index++];
+
+    if (code <= 0) {
+      resetRendition();
+    } else if (code == 1) {
+      rendition.bright = 1;
+    } else if ((code == 5) || (code == 6)) {
+      rendition.blink = 1;
+    } else if (code == 7) {
+      rendition.reverse = 1;
+    } else if ((code == 21) || (code == 22)) {
+      rendition.bright = 0;
+    } else if (code == 25) {
+      rendition.blink = 0;
+    } else if (code == 27) {
+      rendition.reverse = 0;
+    } else if ((code >= 30) && (code <= 37)) {
+      rendition.foreground = code - 30;
+    } else if (code == 39) {
+      rendition.foreground = 7;
+    } else if ((code >= 40) && (code <= 47)) {
+      rendition.background = code - 40;
+    } else if (code == 49) {
+      rendition.background = 0;
+    } else if ((code >= 90) && (code <= 97)) {
+      rendition.foreground = code - 90;
+      rendition.bright = 1;
+    } else if ((code >= 100) && (code <= 107)) {
+      rendition.background = code - 100;
+    } else if ((code == 38) || (code == 48)) {
+      /* extended colours aren't supported - skip their operands */
+      if (index < parseCount) {
+        int type = parseParameters[index++];
+
+        if (type == 5) {
+          index += 1;
+        } else if (type == 2) {
+          index += 3;
+        }
+      }
+    }
+  }
+
+  updateAttributes();
+}
+
+static void
+performControlSequence (unsigned char final) {
+  ScreenCharacter *line = screenLines[cursorRow];
+
+  if (parsePrivate && (parsePrivate != '?')) {
+    /* secondary device attributes and the like */
+    if ((parsePrivate == '>') && (final == 'c')) writeTerminal("\x1b[>0;0;0c", 9);
+    return;
+  }
+
+  switch (final) {
+    case '@': {
+      unsigned int count = getParameter(0, 1);
+      unsigned int left = screenColumns - cursorColumn;
+
+      if (count > left) count = left;
+      memmove(&line[cursorColumn+count], &line[cursorColumn],
+              ARRAY_SIZE(line, (left - count)));
+      clearCharacters(&line[cursorColumn], count);
+      wrapPending = 0;
+      break;
+    }
+
+    case 'A':
+      moveCursor(0, -getParameter(0, 1));
+      break;
+
+    case 'B':
+    case 'e':
+      moveCursor(0, getParameter(0, 1));
+      break;
+
+    case 'C':
+    case 'a':
+      moveCursor(getParameter(0, 1), 0);
+      break;
+
+    case 'D':
+      moveCursor(-getParameter(0, 1), 0);
+      break;
+
+    case 'E':
+      moveCursor(0, getParameter(0, 1));
+      carriageReturn();
+      break;
+
+    case 'F':
+      moveCursor(0, -getParameter(0, 1));
+      carriageReturn();
+      break;
+
+    case 'G':
+    case '`':
+      setCursor(getParameter(0, 1) - 1, cursorRow - (modes.originRelative? scrollTop: 0));
+      break;
+
+    case 'H':
+    case 'f':
+      setCursor(getParameter(1, 1) - 1, getParameter(0, 1) - 1);
+      break;
+
+    case 'J':
+      switch (getParameter(0, 0)) {
+        case 0:
+          clearCharacters(&line[cursorColumn], screenColumns - cursorColumn);
+          clearLines(cursorRow + 1, screenRows);
+          break;
+
+        case 1:
+          clearLines(0, cursorRow);
+          clearCharacters(line, cursorColumn + 1);
+          break;
+
+        case 2:
+        case 3:
+          clearLines(0, screenRows);
+          break;
+      }
+      break;
+
+    case 'K':
+      switch (getParameter(0, 0)) {
+        case 0:
+          clearCharacters(&line[cursorColumn], screenColumns - cursorColumn);
+          break;
+
+        case 1:
+          clearCharacters(line, cursorColumn + 1);
+          break;
+
+        case 2:
+          clearCharacters(line, screenColumns);
+          break;
+      }
+      break;
+
+    case 'L':
+      if ((cursorRow >= scrollTop) && (cursorRow <= scrollBottom)) {
+        scrollDown(cursorRow, scrollBottom, getParameter(0, 1));
+        carriageReturn();
+      }
+      break;
+
+    case 'M':
+      if ((cursorRow >= scrollTop) && (cursorRow <= scrollBottom)) {
+        scrollUp(cursorRow, scrollBottom, getParameter(0, 1));
+        carriageReturn();
+      }
+      break;
+
+    case 'P': {
+      unsigned int count = getParameter(0, 1);
+      unsigned int left = screenColumns - cursorColumn;
+
+      if (count > left) count = left;
+      memmove(&line[cursorColumn], &line[cursorColumn+count],
+              ARRAY_SIZE(line, (left - count)));
+      clearCharacters(&line[screenColumns-count], count);
+      wrapPending = 0;
+      break;
+    }
+
+    case 'S':
+      scrollUp(scrollTop, scrollBottom, getParameter(0, 1));
+      break;
+
+    case 'T':
+      scrollDown(scrollTop, scrollBottom, getParameter(0, 1));
+      break;
+
+    case 'X': {
+      unsigned int count = getParameter(0, 1);
+      unsigned int left = screenColumns - cursorColumn;
+
+      if (count > left) count = left;
+      clearCharacters(&line[cursorColumn], count);
+      wrapPending = 0;
+      break;
+    }
+
+    case 'c':
+      if (!parsePrivate) writeTerminal("\x1b[?6c", 5); /* VT102 */
+      break;
+
+    case 'd':
+      setCursor(cursorColumn, getParameter(0, 1) - 1);
+      break;
+
+    case 'h':
+      setModes(1);
+      break;
+
+    case 'l':
+      setModes(0);
+      break;
+
+    case 'm':
+      selectRendition();
+      break;
+
+    case 'n':
+      switch (getParameter(0, 0)) {
+        case 5:
+          writeTerminal("\x1b[0n", 4);
+          break;
+
+        case 6: {
+          char report[0X20];
+          int length = snprintf(report, sizeof(report), "\x1b[%u;%uR",
+                                cursorRow + 1 - (modes.originRelative? scrollTop: 0),
+                                cursorColumn + 1);
+
+          writeTerminal(report, length);
+          break;
+        }
+      }
+      break;
+
+    case 'r': {
+      unsigned int top = getParameter(0, 1);
+      unsigned int bottom = getParameter(1, screenRows);
+
+      if (bottom > screenRows) bottom = screenRows;
+
+      if (top < bottom) {
+        scrollTop = top - 1;
+        scrollBottom = bottom - 1;
+        setCursor(0, 0);
+      }
+      break;
+    }
+
+    case 's':
+      saveCursor();
+      break;
+
+    case 'u':
+      restoreCursor();
+      break;
+
+    default:
+      logMessage(LOG_CATEGORY(SCREEN_DRIVER), "unsupported control sequence: %c", final);
+      break;
+  }
+}
+
+static void
+performEscapeSequence (unsigned char byte) {
+  parseState = PARSE_GROUND;
+
+  switch (byte) {
+    case '[':
+      parseState = PARSE_CSI;
+      parseCount = 0;
+      parsePrivate = 0;
+      break;
+
+    case ']':
+    case 'P':
+    case '^':
+    case '_':
+      /* operating system command, device control string, etc */
+      parseState = PARSE_STRING;
+      break;
+
+    case '(':
+    case ')':
+    case '*':
+    case '+':
+    case '#':
+    case '%':
+      /* character set designation, line size, etc */
+      parseState = PARSE_DESIGNATE;
+      break;
+
+    case '7':
+      saveCursor();
+      break;
+
+    case '8':
+      restoreCursor();
+      break;
+
+    case 'D':
+      lineFeed();
+      break;
+
+    case 'E':
+      carriageReturn();
+      lineFeed();
+      break;
+
+    case 'M':
+      reverseLineFeed();
+      break;
+
+    case 'Z':
+      writeTerminal("\x1b[?6c", 5);
+      break;
+
+    case 'c':
+      resetTerminal();
+      break;
+
+    case '=':
+    case '>':
+      /* keypad modes */
+      break;
+
+    default:
+      logMessage(LOG_CATEGORY(SCREEN_DRIVER), "unsupported escape sequence: %c", byte);
+      break;
+  }
+}
+
+static void
+performControlCharacter (unsigned char byte) {
+  switch (byte) {
+    case BS:
+      if (cursorColumn > 0) cursorColumn -= 1;
+      wrapPending = 0;
+      screenChanged = 1;
+      break;
+
+    case HT: {
+      unsigned int column = (cursorColumn | 7) + 1;
+
+      if (column >= screenColumns) column = screenColumns - 1;
+      cursorColumn = column;
+      wrapPending = 0;
+      screenChanged = 1;
+      break;
+    }
+
+    case LF:
+    case VT:
+    case FF:
+      lineFeed();
+      if (modes.newLine) carriageReturn();
+      break;
+
+    case CR:
+      carriageReturn();
+      break;
+
+    case ESC:
+      parseState = PARSE_ESCAPE;
+      break;
+
+    case CAN:
+    case SUB:
+      parseState = PARSE_GROUND;
+      break;
+
+    default:
+      break;
+  }
+}
+
+static void
+interpretByte (unsigned char byte) {
+  switch (parseState) {
+    case PARSE_STRING:
+      if (byte == BEL) {
+        parseState = PARSE_GROUND;
+      } else if (byte == ESC) {
+        parseState = PARSE_STRING_ESCAPE;
+      }
+      return;
+
+    case PARSE_STRING_ESCAPE:
+      parseState = (byte == '\\')? PARSE_GROUND: PARSE_STRING;
+      return;
+
+    case PARSE_DESIGNATE:
+      parseState = PARSE_GROUND;
+      return;
+
+    default:
+      break;
+  }
+
+  if (byte < 0X20) {
+    performControlCharacter(byte);
+    return;
+  }
+
+  switch (parseState) {
+    case PARSE_ESCAPE:
+      performEscapeSequence(byte);
+      return;
+
+    case PARSE_CSI:
+      if ((byte >= '0') && (byte <= '9')) {
+        if (!parseCount) parseParameters[parseCount++] = 0;
+
+        if (parseCount <= MAXIMUM_PARAMETERS) {
+          int *parameter = &parseParameters[parseCount-1];
+          if (*parameter < 0) *parameter = 0;
+          if (*parameter < 0XFFFF) *parameter = (*parameter * 10) + (byte - '0');
+        }
+      } else if ((byte == ';') || (byte == ':')) {
+        if (!parseCount) parseParameters[parseCount++] = -1;
+        if (parseCount < MAXIMUM_PARAMETERS) parseParameters[parseCount++] = -1;
+      } else if ((byte >= '<') && (byte <= '?')) {
+        parsePrivate = byte;
+      } else if ((byte >= 0X40) && (byte <= 0X7E)) {
+        parseState = PARSE_GROUND;
+        performControlSequence(byte);
+      } else if (byte >= 0X7F) {
+        parseState = PARSE_GROUND;
+      }
+      return;
+
+    default:
+      break;
+  }
+
+  if (byte == DEL) return;
+
+  if (!isUtf8) {
+    wint_t character = convertCharToWchar(byte);
+    putCharacter((character == WEOF)? WC_C('?'): character);
+  } else if (byte < 0X80) {
+    utf8Remaining = 0;
+    putCharacter(byte);
+  } else if ((byte & 0XC0) == 0X80) {
+    if (utf8Remaining) {
+      utf8Character = (utf8Character << 6) | (byte & 0X3F);
+      if (!--utf8Remaining) putCharacter(utf8Character);
+    }
+  } else {
+    if ((byte & 0XE0) == 0XC0) {
+      utf8Remaining = 1;
+      utf8Character = byte & 0X1F;
+    } else if ((byte & 0XF0) == 0XE0) {
+      utf8Remaining = 2;
+      utf8Character = byte & 0X0F;
+    } else if ((byte & 0XF8) == 0XF0) {
+      utf8Remaining = 3;
+      utf8Character = byte & 0X07;
+    } else {
+      utf8Remaining = 0;
+    }
+  }
+}
+
+static void
+stopShell (void) {
+  if (terminalMonitor) {
+    asyncCancelRequest(terminalMonitor);
+    terminalMonitor = NULL;
+  }
+
+  stopTerminalInput();
+
+  if (terminalDescriptor != INVALID_FILE_DESCRIPTOR) {
+    closeFileDescriptor(terminalDescriptor);
+    terminalDescriptor = INVALID_FILE_DESCRIPTOR;
+  }
+
+  if (shellProcess != -1) {
+    kill(shellProcess, SIGHUP);
+    waitpid(shellProcess, NULL, 0);
+    shellProcess = -1;
+  }
+}
+
+ASYNC_INPUT_CALLBACK(tmHandleTerminalOutput) {
+  if (parameters->error) {
+    /* EIO means that the shell has closed its end of the pseudo-terminal */
+    if (parameters->error != EIO) {
+      logActionError(parameters->error, "pseudo-terminal read");
+    }
+  } else if (parameters->end) {
+    logMessage(LOG_CATEGORY(SCREEN_DRIVER), "pseudo-terminal end-of-file");
+  } else {
+    const unsigned char *byte = parameters->buffer;
+    const unsigned char *end = byte + parameters->length;
+
+    while (byte < end) interpretByte(*byte++);
+
+    if (screenChanged) {
+      screenChanged = 0;
+      mainScreenUpdated();
+    }
+
+    return parameters->length;
+  }
+
+  logMessage(LOG_CATEGORY(SCREEN_DRIVER), "shell ended");
+  asyncDiscardHandle(terminalMonitor);
+  terminalMonitor = NULL;
+  stopTerminalInput();
+
+  closeFileDescriptor(terminalDescriptor);
+  terminalDescriptor = INVALID_FILE_DESCRIPTOR;
+
+  if (shellProcess != -1) {
+    waitpid(shellProcess, NULL, 0);
+    shellProcess = -1;
+  }
+
+  return 0;
+}
+
+static int
+startShell (void) {
+  int master;
+
+  if ((master = posix_openpt(O_RDWR | O_NOCTTY)) != -1) {
+    const char *slave;
+
+    fcntl(master, F_SETFD, FD_CLOEXEC);
+
+    {
+      int flags = fcntl(master, F_GETFL);
+
+      if ((flags == -1) || (fcntl(master, F_SETFL, (flags | O_NONBLOCK)) == -1)) {
+        logSystemError("fcntl[F_SETFL,O_NONBLOCK]");
+      }
+    }
+
+    if ((grantpt(master) != -1) && (unlockpt(master) != -1) && (slave = ptsname(master))) {
+      struct winsize size;
+
+      memset(&size, 0, sizeof(size));
+      size.ws_col = screenColumns;
+      size.ws_row = screenRows;
+      if (ioctl(master, TIOCSWINSZ, &size) == -1) logSystemError("ioctl[TIOCSWINSZ]");
+
+      switch ((shellProcess = fork())) {
+        case -1:
+          logSystemError("fork");
+          break;
+
+        case 0: {
+          int descriptor;
+
+          {
+            sigset_t mask;
+            sigemptyset(&mask);
+            sigprocmask(SIG_SETMASK, &mask, NULL);
+          }
+
+          signal(SIGPIPE, SIG_DFL);
+          signal(SIGINT, SIG_DFL);
+          signal(SIGQUIT, SIG_DFL);
+          signal(SIGTERM, SIG_DFL);
+          signal(SIGCHLD, SIG_DFL);
+
+          if (setsid() == -1) _exit(1);
+          if ((descriptor = open(slave, O_RDWR)) == -1) _exit(1);
+
+#ifdef TIOCSCTTY
+          ioctl(descriptor, TIOCSCTTY, 0);
+#endif /* TIOCSCTTY */
+
+          dup2(descriptor, 0);
+          dup2(descriptor, 1);
+          dup2(descriptor, 2);
+          if (descriptor > 2) close(descriptor);
+
+          setenv("TERM", terminalType, 1);
+          execlp(shellCommand, shellCommand, NULL);
+          _exit(127);
+        }
+
+        default:
+          logMessage(LOG_CATEGORY(SCREEN_DRIVER), "shell started: %s: pid %ld",
+                     shellCommand, (long)shellProcess);
+
+          if (asyncReadFile(&terminalMonitor, master, 0X1000,
+                            tmHandleTerminalOutput, NULL)) {
+            terminalDescriptor = master;
+            return 1;
+          }
+
+          kill(shellProcess, SIGHUP);
+          waitpid(shellProcess, NULL, 0);
+          shellProcess = -1;
+          break;
+      }
+    } else {
+      logSystemError("pseudo-terminal slave");
+    }
+
+    close(master);
+  } else {
+    logSystemError("posix_openpt");
+  }
+
+  return 0;
+}
+
+static void
+deallocateLines (void) {
+  if (screenLines) {
+    unsigned int row;
+
+    for (row=0; row<screenRows; row+=1) {
+      if (screenLines[row]) free(screenLines[row]);
+    }
+
+    free(screenLines);
+    screenLines = NULL;
+  }
+
+  if (historyLines) {
+    while (historyCount) {
+      free(historyLines[historyStart]);
+      historyStart = (historyStart + 1) % historySize;
+      historyCount -= 1;
+    }
+
+    free(historyLines);
+    historyLines = NULL;
+  }
+}
+
+static int
+allocateLines (void) {
+  historyStart = 0;
+  historyCount = 0;
+
+  if ((screenLines = calloc(screenRows, sizeof(*screenLines)))) {
+    unsigned int row;
+
+    for (row=0; row<screenRows; row+=1) {
+      if (!(screenLines[row] = malloc(ARRAY_SIZE(screenLines[row], screenColumns)))) goto error;
+    }
+
+    if (!historySize || (historyLines = calloc(historySize, sizeof(*historyLines)))) return 1;
+  }
+
+error:
+  logMallocError();
+  deallocateLines();
+  return 0;
+}
+
+static int
+construct_TerminalScreen (void) {
+  {
+    const char *charset = getLocaleCharset();
+    isUtf8 = charset && (strcmp(charset, "UTF-8") == 0);
+  }
+
+  if (allocateLines()) {
+    resetTerminal();
+    screenChanged = 0;
+    if (startShell()) return 1;
+
+    deallocateLines();
+  }
+
+  return 0;
+}
+
+static void
+destruct_TerminalScreen (void) {
+  stopShell();
+  deallocateLines();
+}
+
+static int
+poll_TerminalScreen (void) {
+  return 0;
+}
+
+static int
+currentVirtualTerminal_TerminalScreen (void) {
+  return 1;
+}
+
+static void
+describe_TerminalScreen (ScreenDescription *description) {
+  /* the kept lines are above the screen */
+  description->cols = screenColumns;
+  description->rows = historyCount + screenRows;
+  description->posx = cursorColumn;
+  description->posy = historyCount + cursorRow;
+  description->cursor = cursorVisible;
+  description->number = currentVirtualTerminal_TerminalScreen();
+}
+
+static int
+readCharacters_TerminalScreen (const ScreenBox *box, ScreenCharacter *buffer) {
+  if (validateScreenBox(box, screenColumns, historyCount+screenRows)) {
+    int row;
+
+    for (row=box->top; row<(box->top + box->height); row+=1) {
+      const ScreenCharacter *line = (row < historyCount)?
+                                    historyLines[(historyStart + row) % historySize]:
+                                    screenLines[row - historyCount];
+
+      memcpy(buffer, &line[box->left], ARRAY_SIZE(buffer, box->width));
+      buffer += box->width;
+    }
+
+    return 1;
+  }
+
+  return 0;
+}
+
+static int
+insertKey_TerminalScreen (ScreenKey key) {
+  const char *sequence;
+  size_t length;
+  char buffer[0X10];
+
+  if (terminalDescriptor == INVALID_FILE_DESCRIPTOR) {
+    /* the shell has ended - a key starts a new one */
+    resetTerminal();
+    if (!startShell()) return 0;
+    mainScreenUpdated();
+  }
+
+  setScreenKeyModifiers(&key, SCR_KEY_CONTROL);
+
+  {
+    wchar_t character = key & SCR_KEY_CHAR_MASK;
+
+    if (isSpecialKey(key)) {
+#define KEY(key,string) case (key): sequence = (string); break
+#define CURSOR_KEY(key,string1,string2) KEY((key), (modes.cursorKeys? (string1): (string2)))
+
+      switch (character) {
+        KEY(SCR_KEY_ENTER, "\r");
+        KEY(SCR_KEY_TAB, "\t");
+        KEY(SCR_KEY_BACKSPACE, "\x7f");
+        KEY(SCR_KEY_ESCAPE, "\x1b");
+
+        CURSOR_KEY(SCR_KEY_CURSOR_LEFT , "\x1bOD", "\x1b[D");
+        CURSOR_KEY(SCR_KEY_CURSOR_RIGHT, "\x1bOC", "\x1b[C");
+        CURSOR_KEY(SCR_KEY_CURSOR_UP   , "\x1bOA", "\x1b[A");
+        CURSOR_KEY(SCR_KEY_CURSOR_DOWN , "\x1bOB", "\x1b[B");
+
+        KEY(SCR_KEY_PAGE_UP, "\x1b[5~");
+        KEY(SCR_KEY_PAGE_DOWN, "\x1b[6~");
+        KEY(SCR_KEY_HOME, "\x1b[1~");
+        KEY(SCR_KEY_END, "\x1b[4~");
+        KEY(SCR_KEY_INSERT, "\x1b[2~");
+        KEY(SCR_KEY_DELETE, "\x1b[3~");
+        KEY(SCR_KEY_FUNCTION+0, "\x1bOP");
+        KEY(SCR_KEY_FUNCTION+1, "\x1bOQ");
+        KEY(SCR_KEY_FUNCTION+2, "\x1bOR");
+        KEY(SCR_KEY_FUNCTION+3, "\x1bOS");
+        KEY(SCR_KEY_FUNCTION+4, "\x1b[15~");
+        KEY(SCR_KEY_FUNCTION+5, "\x1b[17~");
+        KEY(SCR_KEY_FUNCTION+6, "\x1b[18~");
+        KEY(SCR_KEY_FUNCTION+7, "\x1b[19~");
+        KEY(SCR_KEY_FUNCTION+8, "\x1b[20~");
+        KEY(SCR_KEY_FUNCTION+9, "\x1b[21~");
+        KEY(SCR_KEY_FUNCTION+10, "\x1b[23~");
+        KEY(SCR_KEY_FUNCTION+11, "\x1b[24~");
+
+        default:
+          logMessage(LOG_WARNING, "unsuported key: %04X", key);
+          return 0;
+      }
+
+#undef CURSOR_KEY
+#undef KEY
+
+      length = strlen(sequence);
+    } else {
+      char *byte = buffer;
+
+      if (key & SCR_KEY_ALT_LEFT) *byte++ = ESC;
+
+      if (key & SCR_KEY_CONTROL) {
+        if ((character >= WC_C('@')) && (character <= WC_C('_'))) {
+          character &= 0X1F;
+        } else if ((character >= WC_C('a')) && (character <= WC_C('z'))) {
+          character &= 0X1F;
+        } else if (character == WC_C(' ')) {
+          character = 0;
+        }
+      }
+
+      if (isUtf8) {
+        Utf8Buffer utf8;
+        size_t count = convertWcharToUtf8(character, utf8);
+
+        memcpy(byte, utf8, count);
+        byte += count;
+      } else {
+        int c = convertWcharToChar(character);
+
+        if (c == EOF) {
+          logMessage(LOG_WARNING, "character not supported in local character set: 0X%04X", key);
+          return 0;
+        }
+
+        *byte++ = c;
+      }
+
+      sequence = buffer;
+      length = byte - buffer;
+    }
+  }
+
+  logBytes(LOG_CATEGORY(SCREEN_DRIVER), "insert bytes", sequence, length);
+  writeTerminal(sequence, length);
+  return 1;
+}
+
+static void
+scr_initialize (MainScreen *main) {
+  initializeRealScreen(main);
+  main->base.poll = poll_TerminalScreen;
+  main->base.currentVirtualTerminal = currentVirtualTerminal_TerminalScreen;
+  main->base.describe = describe_TerminalScreen;
+  main->base.readCharacters = readCharacters_TerminalScreen;
+  main->base.insertKey = insertKey_TerminalScreen;
+  main->processParameters = processParameters_TerminalScreen;
+  main->releaseParameters = releaseParameters_TerminalScreen;
+  main->construct = construct_TerminalScreen;
+  main->destruct = destruct_TerminalScreen;
+}
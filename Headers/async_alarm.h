@@ -52,6 +52,8 @@ extern int asyncResetAlarmTo (AsyncHandle handle, const TimeValue *time);
 extern int asyncResetAlarmIn (AsyncHandle handle, int interval);
 extern int asyncResetAlarmEvery (AsyncHandle handle, int interval);
 
+extern void asyncLogAlarms (void);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
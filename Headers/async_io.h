@@ -25,6 +25,12 @@
 extern "C" {
 #endif /* __cplusplus */
 
+/* The maximum number of I/O callbacks made for one wait (0 means no limit).
+ * The operations which are left are handled (first) by the next wait.
+ */
+#define ASYNC_IO_DEFAULT_CALLBACK_LIMIT 0X10
+extern void asyncSetIoCallbackLimit (unsigned int limit);
+
 typedef struct {
   void *data;
   int error;
@@ -230,6 +230,8 @@ typedef enum {
 
   BRL_CMD_TOUCH_NAV /* set touch navigation on/off */,
 
+  BRL_CMD_UPDATE_STATS /* log update scheduling and timing statistics, and the pending alarms */,
+
   BRL_basicCommandCount /* must be last */
 } BRL_BasicCommand;
 
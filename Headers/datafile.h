@@ -48,6 +48,10 @@ typedef struct {
 } DataFileParameters;
 
 extern int processDataFile (const char *name, const DataFileParameters *parameters);
+
+#define DATA_FILE_OPENED_HANDLER(name) void name (const char *path, void *data)
+typedef DATA_FILE_OPENED_HANDLER(DataFileOpenedHandler);
+extern void setDataFileOpenedHandler (DataFileOpenedHandler *handler, void *data);
 extern void reportDataError (DataFile *file, char *format, ...) PRINTF(2, 3);
 
 extern int processDataStream (
@@ -311,6 +311,7 @@ typedef struct {
 extern UsbChannel *usbOpenChannel (const UsbChannelDefinition *definitions, const char *identifier);
 extern void usbCloseChannel (UsbChannel *channel);
 
+extern const char **usbGetDriverCodes (const char *identifier);
 extern int isUsbDevice (const char **identifier);
 
 #ifdef __cplusplus
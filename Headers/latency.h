@@ -0,0 +1,59 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2016 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU General Public License, as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-GPL for details.
+ *
+ * Web Page: http://brltty.com/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+#ifndef BRLTTY_INCLUDED_LATENCY
+#define BRLTTY_INCLUDED_LATENCY
+
+#include "strfmth.h"
+#include "timing.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#define LATENCY_BUCKET_COUNT 32
+
+typedef struct {
+  const char *name;
+
+  unsigned long int count;
+  unsigned long int minimum;
+  unsigned long int maximum;
+  unsigned long long int total;
+
+  /* bucket n counts the samples in [2**(n-1), 2**n) microseconds */
+  unsigned long int buckets[LATENCY_BUCKET_COUNT];
+} LatencyHistogram;
+
+#define LATENCY_HISTOGRAM_INITIALIZER(label) { .name = (label) }
+
+extern void resetLatencyHistogram (LatencyHistogram *histogram);
+extern void addLatencySample (LatencyHistogram *histogram, unsigned long int microseconds);
+extern void addLatencySince (LatencyHistogram *histogram, TimeValue *start);
+
+extern unsigned long int getLatencyAverage (const LatencyHistogram *histogram);
+extern unsigned long int getLatencyPercentile (const LatencyHistogram *histogram, unsigned int percent);
+
+extern STR_DECLARE_FORMATTER(formatLatencyHistogram, const LatencyHistogram *histogram);
+extern void logLatencyHistogram (const LatencyHistogram *histogram, int level);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* BRLTTY_INCLUDED_LATENCY */
@@ -25,6 +25,8 @@
 #include <signal.h>
 
 #include "options.h"
+#include "parse.h"
+#include "timing.h"
 #include "brl_cmds.h"
 #include "brl_dots.h"
 #include "cmd.h"
@@ -41,6 +43,7 @@ static int opt_showName;
 static int opt_showSize;
 static int opt_showKeyCodes;
 static int opt_suspendMode;
+static char *opt_throughputCount;
 
 BEGIN_OPTION_TABLE(programOptions)
   { .letter = 'n',
@@ -79,6 +82,13 @@ BEGIN_OPTION_TABLE(programOptions)
     .description = "Suspend the braille driver (press ^C or send SIGUSR1 to resume)."
   },
 
+  { .letter = 't',
+    .word = "throughput",
+    .argument = "count",
+    .setting.string = &opt_throughputCount,
+    .description = "Measure throughput by streaming count display updates while reading keys."
+  },
+
   { .letter = 'b',
     .word = "brlapi",
     .argument = "[host][:port]",
@@ -229,6 +239,81 @@ static void showKeyCodes(void)
   brlapi_perror("brlapi_readKey");
 }
 
+static void measureThroughput(void)
+{
+  static const int minimum = 1;
+  int count;
+  unsigned int x, y;
+  char name[30];
+  int keys = 0;
+  TimeValue start, end;
+  long int elapsed;
+
+  if (!validateInteger(&count, opt_throughputCount, &minimum, NULL)) {
+    fprintf(stderr, "invalid update count: %s\n", opt_throughputCount);
+    exit(PROG_EXIT_SYNTAX);
+  }
+
+  if (brlapi_getDisplaySize(&x, &y)<0) {
+    brlapi_perror("getDisplaySize");
+    exit(PROG_EXIT_FATAL);
+  }
+  if (brlapi_enterTtyMode(-1, NULL)<0) {
+    brlapi_perror("enterTtyMode");
+    exit(PROG_EXIT_FATAL);
+  }
+
+  fprintf(stderr, "Streaming %d updates\n", count);
+  getMonotonicTime(&start);
+
+  {
+    char text[x*y+1];
+    brlapi_writeArguments_t wa = BRLAPI_WRITEARGUMENTS_INITIALIZER;
+    int update;
+
+    wa.regionBegin = 1;
+    wa.regionSize = x*y;
+    wa.text = text;
+
+    for (update=0; update<count; update+=1) {
+      brlapi_keyCode_t code;
+      int res;
+      int length = snprintf(text, sizeof(text), "update %d", update);
+
+      if (length < 0) length = 0;
+      if (length < (int)(x*y)) memset(&text[length], ' ', (x*y)-length);
+      text[x*y] = 0;
+
+      if (brlapi_write(&wa)<0) {
+        brlapi_perror("brlapi_write");
+        exit(PROG_EXIT_FATAL);
+      }
+
+      while ((res = brlapi_readKey(0, &code)) == 1) keys += 1;
+      if (res<0) {
+        brlapi_perror("brlapi_readKey");
+        exit(PROG_EXIT_FATAL);
+      }
+    }
+  }
+
+  /* a request/response round trip ensures that every update has been handled */
+  if (brlapi_getDriverName(name, sizeof(name))<0) {
+    brlapi_perror("getDriverName");
+    exit(PROG_EXIT_FATAL);
+  }
+
+  getMonotonicTime(&end);
+  elapsed = microsecondsBetween(&start, &end);
+  if (elapsed < 1) elapsed = 1;
+
+  fprintf(stderr, "%d updates in %ld.%03ldms (%.1f updates/s), %d keys read\n",
+          count, elapsed/1000, elapsed%1000,
+          (double)count * 1000000.0 / elapsed, keys);
+
+  brlapi_leaveTtyMode();
+}
+
 #ifdef SIGUSR1
 static void emptySignalHandler(int sig) { }
 #endif /* SIGUSR1 */
@@ -305,6 +390,10 @@ main (int argc, char *argv[]) {
       suspendDriver();
     }
 
+    if (opt_throughputCount) {
+      measureThroughput();
+    }
+
     brlapi_closeConnection();
     fprintf(stderr, "Disconnected\n"); 
   } else {
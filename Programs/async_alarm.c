@@ -32,6 +32,8 @@ typedef struct {
   AsyncAlarmCallback *callback;
   void *data;
 
+  unsigned int batch;
+
   unsigned active:1;
   unsigned cancel:1;
   unsigned reschedule:1;
@@ -39,12 +41,53 @@ typedef struct {
 
 struct AsyncAlarmDataStruct {
   Queue *alarmQueue;
+  unsigned int batchCounter;
 };
 
+typedef struct {
+  TimeValue now;
+  int level;
+} LogAlarmData;
+
+static int
+logAlarm (void *item, void *data) {
+  const AlarmEntry *alarm = item;
+  const LogAlarmData *lad = data;
+
+  logSymbol(lad->level, alarm->callback,
+            "alarm: in %ld%s%s",
+            millisecondsBetween(&lad->now, &alarm->time),
+            (alarm->reschedule? " (periodic)": ""),
+            (alarm->active? " (active)": ""));
+
+  return 0;
+}
+
+static void
+logAlarms (Queue *alarms, int level, const char *label) {
+  if (alarms) {
+    int count = getQueueSize(alarms);
+
+    if (count > 0) {
+      LogAlarmData lad = {
+        .level = level
+      };
+
+      getMonotonicTime(&lad.now);
+      logMessage(level, "%s: %d", label, count);
+      processQueue(alarms, logAlarm, &lad);
+    }
+  }
+}
+
 void
 asyncDeallocateAlarmData (AsyncAlarmData *ad) {
   if (ad) {
-    if (ad->alarmQueue) deallocateQueue(ad->alarmQueue);
+    if (ad->alarmQueue) {
+      logAlarms(ad->alarmQueue, LOG_CATEGORY(ASYNC_EVENTS), "alarms still pending");
+      deallocateQueue(ad->alarmQueue);
+    }
+
     free(ad);
   }
 }
@@ -64,6 +107,7 @@ getAlarmData (void) {
 
     memset(ad, 0, sizeof(*ad));
     ad->alarmQueue = NULL;
+    ad->batchCounter = 0;
     tsd->alarmData = ad;
   }
 
@@ -135,6 +179,7 @@ newAlarmElement (const void *parameters) {
 
       alarm->callback = aep->callback;
       alarm->data = aep->data;
+      alarm->batch = 0;
 
       alarm->active = 0;
       alarm->cancel = 0;
@@ -232,11 +277,50 @@ asyncResetAlarmEvery (AsyncHandle handle, int interval) {
   return 0;
 }
 
+void
+asyncLogAlarms (void) {
+  logAlarms(getAlarmQueue(0), LOG_NOTICE, "alarms pending");
+}
+
 static int
-testInactiveAlarm (void *item, void *data) {
+testPendingAlarm (void *item, void *data) {
   const AlarmEntry *alarm = item;
+  const unsigned int *batch = data;
 
-  return !alarm->active;
+  return !alarm->active && (alarm->batch != *batch);
+}
+
+static void
+executeAlarm (Element *element, unsigned int batch) {
+  AlarmEntry *alarm = getElementItem(element);
+  AsyncAlarmCallback *callback = alarm->callback;
+  TimeValue now;
+
+  getMonotonicTime(&now);
+
+  {
+    const AsyncAlarmCallbackParameters parameters = {
+      .now = &now,
+      .data = alarm->data
+    };
+
+    logSymbol(LOG_CATEGORY(ASYNC_EVENTS), callback, "alarm starting");
+    alarm->batch = batch;
+    alarm->active = 1;
+    if (callback) callback(&parameters);
+    alarm->active = 0;
+  }
+
+  if (alarm->reschedule) {
+    adjustTimeValue(&alarm->time, alarm->interval);
+    getMonotonicTime(&now);
+    if (compareTimeValues(&alarm->time, &now) < 0) alarm->time = now;
+    requeueElement(element);
+  } else {
+    alarm->cancel = 1;
+  }
+
+  if (alarm->cancel) deleteElement(element);
 }
 
 int
@@ -245,46 +329,57 @@ asyncExecuteAlarmCallback (AsyncAlarmData *ad, long int *timeout) {
     Queue *alarms = ad->alarmQueue;
 
     if (alarms) {
-      Element *element = processQueue(alarms, testInactiveAlarm, NULL);
-
-      if (element) {
-        AlarmEntry *alarm = getElementItem(element);
-        TimeValue now;
-        long int milliseconds;
-
-        getMonotonicTime(&now);
-        milliseconds = millisecondsBetween(&now, &alarm->time);
-
-        if (milliseconds <= 0) {
-          AsyncAlarmCallback *callback = alarm->callback;
-          const AsyncAlarmCallbackParameters parameters = {
-            .now = &now,
-            .data = alarm->data
-          };
-
-          logSymbol(LOG_CATEGORY(ASYNC_EVENTS), callback, "alarm starting");
-          alarm->active = 1;
-          if (callback) callback(&parameters);
-          alarm->active = 0;
-
-          if (alarm->reschedule) {
-            adjustTimeValue(&alarm->time, alarm->interval);
-            getMonotonicTime(&now);
-            if (compareTimeValues(&alarm->time, &now) < 0) alarm->time = now;
-            requeueElement(element);
-          } else {
-            alarm->cancel = 1;
+      /* Run every alarm which is due as of now, each at most once, so that
+       * alarms which expire together don't each cost a pass through the wait.
+       * A periodic alarm which falls behind is requeued for the next batch.
+       */
+      unsigned int batch;
+      unsigned int executed = 0;
+      TimeValue now;
+      Element *element;
+
+      /* zero is the batch of alarms which have never been executed */
+      if (!(batch = ++ad->batchCounter)) batch = ++ad->batchCounter;
+      getMonotonicTime(&now);
+
+      while ((element = processQueue(alarms, testPendingAlarm, &batch))) {
+        const AlarmEntry *alarm = getElementItem(element);
+
+        if (compareTimeValues(&alarm->time, &now) > 0) {
+          if (!executed) {
+            long int milliseconds = millisecondsBetween(&now, &alarm->time);
+
+            /* Round up so that the wait doesn't end just before the alarm is
+             * due and then spin on a zero timeout. The sub-millisecond
+             * remainder is checked separately (rather than computing the
+             * interval in microseconds) so that a far off alarm can't
+             * overflow a 32-bit long.
+             */
+            {
+              TimeValue time = now;
+
+              adjustTimeValue(&time, milliseconds);
+              if (compareTimeValues(&time, &alarm->time) < 0) milliseconds += 1;
+            }
+
+            if (milliseconds < *timeout) {
+              *timeout = milliseconds;
+              logSymbol(LOG_CATEGORY(ASYNC_EVENTS), alarm->callback, "next alarm: %ld", *timeout);
+            }
           }
 
-          if (alarm->cancel) deleteElement(element);
-          return 1;
+          break;
         }
 
-        if (milliseconds < *timeout) {
-          *timeout = milliseconds;
-          logSymbol(LOG_CATEGORY(ASYNC_EVENTS), alarm->callback, "next alarm: %ld", *timeout);
-        }
+        executeAlarm(element, batch);
+        executed += 1;
+      }
+
+      if (executed > 1) {
+        logMessage(LOG_CATEGORY(ASYNC_EVENTS), "alarms executed: %u", executed);
       }
+
+      return executed > 0;
     }
   }
 
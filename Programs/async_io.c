@@ -154,8 +154,16 @@ typedef struct {
 
 struct AsyncIoDataStruct {
   Queue *functionQueue;
+  unsigned int waitCounter;
 };
 
+static unsigned int callbackLimit = ASYNC_IO_DEFAULT_CALLBACK_LIMIT;
+
+void
+asyncSetIoCallbackLimit (unsigned int limit) {
+  callbackLimit = limit;
+}
+
 void
 asyncDeallocateIoData (AsyncIoData *iod) {
   if (iod) {
@@ -179,6 +187,7 @@ getIoData (void) {
 
     memset(iod, 0, sizeof(*iod));
     iod->functionQueue = NULL;
+    iod->waitCounter = 0;
     tsd->ioData = iod;
   }
 
@@ -718,12 +727,45 @@ testFunctionMonitor (void *item, void *data) {
   return 0;
 }
 
+static void
+executeFunction (Element *functionElement) {
+  FunctionEntry *function = getElementItem(functionElement);
+  Element *operationElement = getActiveOperationElement(function);
+  OperationEntry *operation = getElementItem(operationElement);
+
+  /* it mustn't be tested again within the same wait */
+  operation->monitor = NULL;
+
+  if (!operation->finished) finishOperation(operation);
+
+  operation->active = 1;
+  if (!function->methods->invokeCallback(operation)) operation->cancel = 1;
+  operation->active = 0;
+
+  if (operation->cancel) {
+    deleteElement(operationElement);
+  } else {
+    operation->error = 0;
+  }
+
+  /* moving it to the end of the queue lets the others go first next time */
+  if ((operationElement = getActiveOperationElement(function))) {
+    operation = getElementItem(operationElement);
+    if (!operation->finished) startOperation(operation);
+    requeueElement(functionElement);
+  } else {
+    deleteElement(functionElement);
+  }
+}
+
 int
 asyncExecuteIoCallback (AsyncIoData *iod, long int timeout) {
   if (iod) {
     Queue *functions = iod->functionQueue;
     unsigned int functionCount = functions? getQueueSize(functions): 0;
 
+    unsigned int waitCounter = ++iod->waitCounter;
+
     prepareMonitors();
 
     if (functionCount) {
@@ -736,42 +778,34 @@ asyncExecuteIoCallback (AsyncIoData *iod, long int timeout) {
       int executed = 0;
       Element *functionElement = processQueue(functions, addFunctionMonitor, &monitors);
 
-      if (!functionElement) {
-        if (!monitors.count) {
-          approximateDelay(timeout);
-        } else if (awaitMonitors(&monitors, timeout)) {
-          functionElement = processQueue(functions, testFunctionMonitor, NULL);
-        }
-      }
-
       if (functionElement) {
-        FunctionEntry *function = getElementItem(functionElement);
-        Element *operationElement = getActiveOperationElement(function);
-        OperationEntry *operation = getElementItem(operationElement);
-
-        if (!operation->finished) finishOperation(operation);
-
-        operation->active = 1;
-        if (!function->methods->invokeCallback(operation)) operation->cancel = 1;
-        operation->active = 0;
+        executeFunction(functionElement);
         executed = 1;
+      } else if (!monitors.count) {
+        approximateDelay(timeout);
+      } else {
+        if (awaitMonitors(&monitors, timeout)) {
+          unsigned int limit = callbackLimit;
+
+          /* Handle every operation which is ready - each at most once.
+           * A callback which waits (recursively) rebuilds the monitors,
+           * so those which are left must then be found by the next wait.
+           */
+          while ((functionElement = processQueue(functions, testFunctionMonitor, NULL))) {
+            executeFunction(functionElement);
+            executed += 1;
+
+            if (iod->waitCounter != waitCounter) break;
+            if (limit && !--limit) break;
+          }
 
-        if (operation->cancel) {
-          deleteElement(operationElement);
-        } else {
-          operation->error = 0;
-        }
-
-        if ((operationElement = getActiveOperationElement(function))) {
-          operation = getElementItem(operationElement);
-          if (!operation->finished) startOperation(operation);
-          requeueElement(functionElement);
-        } else {
-          deleteElement(functionElement);
+          if (executed > 1) {
+            logMessage(LOG_CATEGORY(ASYNC_EVENTS), "I/O callbacks: %d", executed);
+          }
         }
       }
 
-      return executed;
+      return executed > 0;
     }
   }
 
@@ -21,6 +21,7 @@
 #include "blink.h"
 #include "prefs.h"
 #include "async_alarm.h"
+#include "timing.h"
 #include "update.h"
 #include "core.h"
 
@@ -32,7 +33,8 @@ struct BlinkDescriptorStruct {
 
   unsigned isRequired:1;
   unsigned isVisible:1;
-  AsyncHandle alarmHandle;
+  unsigned isActive:1;
+  TimeValue nextChange;
 };
 
 BlinkDescriptor screenCursorBlinkDescriptor = {
@@ -63,6 +65,15 @@ BlinkDescriptor speechCursorBlinkDescriptor = {
   .invisibleTime = &prefs.speechCursorInvisibleTime
 };
 
+/* All of the blink descriptors share one alarm, which is set for the earliest
+ * state change. Changes which are due within this many milliseconds of one
+ * another are made together, and are then followed by a single update.
+ */
+#define BLINK_COALESCE_INTERVAL 30
+
+static AsyncHandle blinkAlarm = NULL;
+static TimeValue blinkAlarmTime;
+
 static BlinkDescriptor *const blinkDescriptors[] = {
   &screenCursorBlinkDescriptor,
   &attributesUnderlineBlinkDescriptor,
@@ -82,41 +93,125 @@ getBlinkDuration (const BlinkDescriptor *blink) {
   return PREFERENCES_TIME(blink->isVisible? *blink->visibleTime: *blink->invisibleTime);
 }
 
-void
-setBlinkState (BlinkDescriptor *blink, int visible) {
-  int changed = visible != blink->isVisible;
+static void
+forEachBlinkDescriptor (void (*handleBlinkDescriptor) (BlinkDescriptor *blink)) {
+  BlinkDescriptor *const *blink = blinkDescriptors;
 
-  blink->isVisible = visible;
+  while (*blink) handleBlinkDescriptor(*blink++);
+}
 
-  if (blink->alarmHandle) {
-    asyncResetAlarmIn(blink->alarmHandle, getBlinkDuration(blink));
-    if (changed) scheduleUpdate("blink state set");
+static const TimeValue *
+getNextBlinkChange (void) {
+  const TimeValue *next = NULL;
+  BlinkDescriptor *const *blink = blinkDescriptors;
+
+  while (*blink) {
+    if ((*blink)->isActive) {
+      const TimeValue *time = &(*blink)->nextChange;
+
+      if (!next || (compareTimeValues(time, next) < 0)) next = time;
+    }
+
+    blink += 1;
   }
+
+  return next;
 }
 
-static void setBlinkAlarm (BlinkDescriptor *blink);
+static void setBlinkAlarm (void);
 
 ASYNC_ALARM_CALLBACK(handleBlinkAlarm) {
-  BlinkDescriptor *blink = parameters->data;
+  const TimeValue *next = getNextBlinkChange();
+  int changed = 0;
+
+  asyncDiscardHandle(blinkAlarm);
+  blinkAlarm = NULL;
+
+  if (next) {
+    TimeValue time = *next;
+    TimeValue limit = *parameters->now;
+    BlinkDescriptor *const *blink = blinkDescriptors;
+
+    adjustTimeValue(&limit, BLINK_COALESCE_INTERVAL);
+
+    while (*blink) {
+      BlinkDescriptor *descriptor = *blink++;
+
+      if (descriptor->isActive) {
+        if (compareTimeValues(&descriptor->nextChange, &limit) <= 0) {
+          descriptor->isVisible = !descriptor->isVisible;
+          changed = 1;
+
+          /* Timing from the shared change time keeps the phases of
+           * descriptors with the same durations aligned.
+           */
+          descriptor->nextChange = time;
+          adjustTimeValue(&descriptor->nextChange, getBlinkDuration(descriptor));
 
-  asyncDiscardHandle(blink->alarmHandle);
-  blink->alarmHandle = NULL;
+          if (compareTimeValues(&descriptor->nextChange, parameters->now) < 0) {
+            descriptor->nextChange = *parameters->now;
+          }
+        }
+      }
+    }
+  }
 
-  blink->isVisible = !blink->isVisible;
-  setBlinkAlarm(blink);
-  scheduleUpdate("blink state changed");
+  setBlinkAlarm();
+  if (changed) scheduleUpdate("blink state changed");
 }
 
 static void
-setBlinkAlarm (BlinkDescriptor *blink) {
-  asyncSetAlarmIn(&blink->alarmHandle, getBlinkDuration(blink), handleBlinkAlarm, blink);
+setBlinkAlarm (void) {
+  const TimeValue *next = getNextBlinkChange();
+
+  if (next) {
+    if (!blinkAlarm) {
+      if (asyncSetAlarmTo(&blinkAlarm, next, handleBlinkAlarm, NULL)) {
+        blinkAlarmTime = *next;
+      }
+    } else if (compareTimeValues(next, &blinkAlarmTime) != 0) {
+      if (asyncResetAlarmTo(blinkAlarm, next)) {
+        blinkAlarmTime = *next;
+      }
+    }
+  } else if (blinkAlarm) {
+    asyncCancelRequest(blinkAlarm);
+    blinkAlarm = NULL;
+  }
 }
 
 static void
-forEachBlinkDescriptor (void (*handleBlinkDescriptor) (BlinkDescriptor *blink)) {
-  BlinkDescriptor *const *blink = blinkDescriptors;
+startBlinkDescriptor (BlinkDescriptor *blink) {
+  const TimeValue *next = getNextBlinkChange();
+  TimeValue now;
 
-  while (*blink) handleBlinkDescriptor(*blink++);
+  getMonotonicTime(&now);
+  blink->nextChange = now;
+  adjustTimeValue(&blink->nextChange, getBlinkDuration(blink));
+
+  if (next) {
+    /* join the phase of the blinking which is already in progress */
+    long int difference = millisecondsBetween(next, &blink->nextChange);
+
+    if ((difference >= -BLINK_COALESCE_INTERVAL) && (difference <= BLINK_COALESCE_INTERVAL)) {
+      blink->nextChange = *next;
+    }
+  }
+
+  blink->isActive = 1;
+}
+
+void
+setBlinkState (BlinkDescriptor *blink, int visible) {
+  int changed = visible != blink->isVisible;
+
+  blink->isVisible = visible;
+
+  if (blink->isActive) {
+    startBlinkDescriptor(blink);
+    setBlinkAlarm();
+    if (changed) scheduleUpdate("blink state set");
+  }
 }
 
 static void
@@ -134,29 +229,33 @@ requireBlinkDescriptor (BlinkDescriptor *blink) {
   blink->isRequired = 1;
 }
 
+int
+isBlinkDescriptorRequired (const BlinkDescriptor *blink) {
+  return blink->isRequired;
+}
+
 static void
 stopBlinkDescriptor (BlinkDescriptor *blink) {
-  if (blink->alarmHandle) {
-    asyncCancelRequest(blink->alarmHandle);
-    blink->alarmHandle = NULL;
-  }
+  blink->isActive = 0;
 }
 
 void
 stopAllBlinkDescriptors (void) {
   forEachBlinkDescriptor(stopBlinkDescriptor);
+  setBlinkAlarm();
 }
 
 static void
 resetBlinkDescriptor (BlinkDescriptor *blink) {
   if (!(*blink->isEnabled && blink->isRequired)) {
     stopBlinkDescriptor(blink);
-  } else if (!blink->alarmHandle) {
-    setBlinkAlarm(blink);
+  } else if (!blink->isActive) {
+    startBlinkDescriptor(blink);
   }
 }
 
 void
 resetAllBlinkDescriptors (void) {
   forEachBlinkDescriptor(resetBlinkDescriptor);
+  setBlinkAlarm();
 }
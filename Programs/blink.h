@@ -34,6 +34,7 @@ extern void setBlinkState (BlinkDescriptor *blink, int visible);
 
 extern void unrequireAllBlinkDescriptors (void);
 extern void requireBlinkDescriptor (BlinkDescriptor *blink);
+extern int isBlinkDescriptorRequired (const BlinkDescriptor *blink);
 
 extern void resetAllBlinkDescriptors (void);
 extern void stopAllBlinkDescriptors (void);
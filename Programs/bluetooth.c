@@ -18,10 +18,12 @@
 
 #include "prologue.h"
 
+#include <stdio.h>
 #include <string.h>
 #include <errno.h>
 
 #include "log.h"
+#include "file.h"
 #include "parameters.h"
 #include "timing.h"
 #include "async_wait.h"
@@ -64,6 +66,7 @@ typedef struct {
   uint64_t bda;
   int connectError;
   char *deviceName;
+  uint8_t channel; /* the RFCOMM channel of the last successful connect */
 } BluetoothDeviceEntry;
 
 static void
@@ -79,14 +82,6 @@ bthCreateDeviceQueue (void *data) {
   return newQueue(bthDeallocateDeviceEntry, NULL);
 }
 
-static Queue *
-bthGetDeviceQueue (int create) {
-  static Queue *devices = NULL;
-
-  return getProgramQueue(&devices, "bluetooth-device-queue", create,
-                         bthCreateDeviceQueue, NULL);
-}
-
 static int
 bthTestDeviceEntry (const void *item, void *data) {
   const BluetoothDeviceEntry *entry = item;
@@ -96,27 +91,175 @@ bthTestDeviceEntry (const void *item, void *data) {
 }
 
 static BluetoothDeviceEntry *
-bthGetDeviceEntry (uint64_t bda, int add) {
-  Queue *devices = bthGetDeviceQueue(add);
+bthAddDeviceEntry (Queue *devices, uint64_t bda) {
+  BluetoothDeviceEntry *entry;
 
-  if (devices) {
-    BluetoothDeviceEntry *entry = findItem(devices, bthTestDeviceEntry, &bda);
-    if (entry) return entry;
+  if ((entry = malloc(sizeof(*entry)))) {
+    entry->bda = bda;
+    entry->connectError = 0;
+    entry->deviceName = NULL;
+    entry->channel = 0;
 
-    if (add) {
-      if ((entry = malloc(sizeof(*entry)))) {
-        entry->bda = bda;
-        entry->connectError = 0;
-        entry->deviceName = NULL;
+    if (enqueueItem(devices, entry)) return entry;
+    free(entry);
+  } else {
+    logMallocError();
+  }
 
-        if (enqueueItem(devices, entry)) return entry;
-        free(entry);
-      } else {
-        logMallocError();
+  return NULL;
+}
+
+/* The name and the RFCOMM channel of each device are also kept in a file
+ * within the updatable directory so that reconnecting to a known device
+ * (after a restart, a suspend, a lost link, etc) needn't wait for the
+ * name to be obtained or for the channel to be discovered.
+ * Each line contains: address channel [name]
+ */
+
+static const char bthDeviceCacheFile[] = "bluetooth-devices";
+static int bthDeviceCacheLoaded = 0;
+
+static void
+bthFormatAddress (char *buffer, size_t size, uint64_t bda) {
+  snprintf(buffer, size, "%02X:%02X:%02X:%02X:%02X:%02X",
+           (unsigned int)((bda >> 40) & 0XFF),
+           (unsigned int)((bda >> 32) & 0XFF),
+           (unsigned int)((bda >> 24) & 0XFF),
+           (unsigned int)((bda >> 16) & 0XFF),
+           (unsigned int)((bda >>  8) & 0XFF),
+           (unsigned int)((bda >>  0) & 0XFF));
+}
+
+static int
+bthLoadDeviceCacheLine (char *line, void *data) {
+  Queue *devices = data;
+  static const char delimiters[] = " \t";
+  const char *address = strtok(line, delimiters);
+
+  if (address && (*address != '#')) {
+    const char *channel = strtok(NULL, delimiters);
+    char *name = strtok(NULL, "");
+    uint64_t bda;
+    uint8_t number;
+
+    if (!channel) {
+      logMessage(LOG_WARNING, "Bluetooth device cache: channel not specified: %s", address);
+    } else if (bthParseAddress(&bda, address)) {
+      if (strcmp(channel, "0") == 0) {
+        number = 0;
+      } else if (!bthParseChannelNumber(&number, channel)) {
+        return 1;
+      }
+
+      if (!findItem(devices, bthTestDeviceEntry, &bda)) {
+        BluetoothDeviceEntry *entry = bthAddDeviceEntry(devices, bda);
+
+        if (entry) {
+          entry->channel = number;
+
+          if (name) {
+            name += strspn(name, delimiters);
+
+            if (*name) {
+              if (!(entry->deviceName = strdup(name))) logMallocError();
+            }
+          }
+        }
       }
     }
   }
 
+  return 1;
+}
+
+static void
+bthLoadDeviceCache (Queue *devices) {
+  char *path = makeUpdatablePath(bthDeviceCacheFile);
+
+  if (path) {
+    FILE *file = openFile(path, "r", 1);
+
+    if (file) {
+      processLines(file, bthLoadDeviceCacheLine, devices);
+      fclose(file);
+      logMessage(LOG_CATEGORY(BLUETOOTH_IO), "cached devices: %d", getQueueSize(devices));
+    }
+
+    free(path);
+  }
+}
+
+static int
+bthSaveDeviceCacheEntry (void *item, void *data) {
+  const BluetoothDeviceEntry *entry = item;
+  FILE *file = data;
+
+  if (entry->channel || entry->deviceName) {
+    char address[0X20];
+
+    bthFormatAddress(address, sizeof(address), entry->bda);
+    if (fprintf(file, "%s %u", address, entry->channel) < 0) return 1;
+    if (entry->deviceName && (fprintf(file, " %s", entry->deviceName) < 0)) return 1;
+    if (fputc('\n', file) == EOF) return 1;
+  }
+
+  return 0;
+}
+
+static void
+bthSaveDeviceCache (Queue *devices) {
+  char *path = makeUpdatablePath(bthDeviceCacheFile);
+
+  if (path) {
+    const char *extension = ".new";
+    char newPath[strlen(path) + strlen(extension) + 1];
+    FILE *file;
+
+    snprintf(newPath, sizeof(newPath), "%s%s", path, extension);
+
+    if ((file = openFile(newPath, "w", 0))) {
+      int ok = fprintf(file, "# %s Bluetooth Device Cache\n", PACKAGE_NAME) >= 0;
+
+      if (ok && processQueue(devices, bthSaveDeviceCacheEntry, file)) ok = 0;
+      if (fclose(file) == EOF) ok = 0;
+
+      if (!ok) {
+        logMessage(LOG_WARNING, "Bluetooth device cache not written: %s", newPath);
+        unlink(newPath);
+      } else if (rename(newPath, path) == -1) {
+        logSystemError("rename");
+        unlink(newPath);
+      }
+    }
+
+    free(path);
+  }
+}
+
+static Queue *
+bthGetDeviceQueue (int create) {
+  static Queue *devices = NULL;
+  Queue *queue = getProgramQueue(&devices, "bluetooth-device-queue", create,
+                                 bthCreateDeviceQueue, NULL);
+
+  if (queue && !bthDeviceCacheLoaded) {
+    bthDeviceCacheLoaded = 1;
+    bthLoadDeviceCache(queue);
+  }
+
+  return queue;
+}
+
+static BluetoothDeviceEntry *
+bthGetDeviceEntry (uint64_t bda, int add) {
+  Queue *devices = bthGetDeviceQueue(1);
+
+  if (devices) {
+    BluetoothDeviceEntry *entry = findItem(devices, bthTestDeviceEntry, &bda);
+    if (entry) return entry;
+    if (add) return bthAddDeviceEntry(devices, bda);
+  }
+
   return NULL;
 }
 
@@ -124,7 +267,34 @@ void
 bthForgetDevices (void) {
   Queue *devices = bthGetDeviceQueue(0);
 
-  if (devices) deleteElements(devices);
+  if (devices) {
+    deleteElements(devices);
+
+    /* what's still valid will be reloaded */
+    bthDeviceCacheLoaded = 0;
+  }
+}
+
+static void
+bthRememberChannel (uint64_t bda, uint8_t channel) {
+  BluetoothDeviceEntry *entry = bthGetDeviceEntry(bda, 1);
+
+  if (entry) {
+    if (entry->channel != channel) {
+      entry->channel = channel;
+      bthSaveDeviceCache(bthGetDeviceQueue(1));
+    }
+  }
+}
+
+static int
+bthRecallChannel (uint64_t bda, uint8_t *channel) {
+  BluetoothDeviceEntry *entry = bthGetDeviceEntry(bda, 0);
+  if (!entry) return 0;
+  if (!entry->channel) return 0;
+
+  *channel = entry->channel;
+  return 1;
 }
 
 static int
@@ -146,6 +316,21 @@ bthRecallConnectError (uint64_t bda, int *value) {
   return 1;
 }
 
+static int
+bthConnectChannel (BluetoothConnection *connection, int timeout) {
+  TimePeriod period;
+  startTimePeriod(&period, BLUETOOTH_CHANNEL_BUSY_RETRY_TIMEOUT);
+
+  while (1) {
+    if (bthOpenChannel(connection->extension, connection->channel, timeout)) return 1;
+    if (afterTimePeriod(&period, NULL)) break;
+    if (errno != EBUSY) break;
+    asyncWait(BLUETOOTH_CHANNEL_BUSY_RETRY_INTERVAL);
+  }
+
+  return 0;
+}
+
 static BluetoothConnection *
 bthNewConnection (const char *address, uint8_t channel, int discover, int timeout) {
   BluetoothConnection *connection;
@@ -157,8 +342,17 @@ bthNewConnection (const char *address, uint8_t channel, int discover, int timeou
     if (bthParseAddress(&connection->address, address)) {
       if ((connection->extension = bthNewConnectionExtension(connection->address))) {
         int alreadyTried = 0;
+        int cached = 0;
+
+        if (discover) {
+          if (bthRecallChannel(connection->address, &connection->channel)) {
+            logMessage(LOG_CATEGORY(BLUETOOTH_IO), "using cached serial port channel");
+            cached = 1;
+          } else {
+            bthDiscoverSerialPortChannel(&connection->channel, connection->extension, timeout);
+          }
+        }
 
-        if (discover) bthDiscoverSerialPortChannel(&connection->channel, connection->extension, timeout);
         bthLogChannel(connection->channel);
 
         {
@@ -171,17 +365,26 @@ bthNewConnection (const char *address, uint8_t channel, int discover, int timeou
         }
 
         if (!alreadyTried) {
-          TimePeriod period;
-          startTimePeriod(&period, BLUETOOTH_CHANNEL_BUSY_RETRY_TIMEOUT);
-
-          while (1) {
-            if (bthOpenChannel(connection->extension, connection->channel, timeout)) {
-              return connection;
+          int connected = bthConnectChannel(connection, timeout);
+
+          if (!connected && cached) {
+            /* the device may have been reconfigured */
+            int error = errno;
+            uint8_t channel;
+
+            if (bthDiscoverSerialPortChannel(&channel, connection->extension, timeout) &&
+                (channel != connection->channel)) {
+              connection->channel = channel;
+              bthLogChannel(connection->channel);
+              connected = bthConnectChannel(connection, timeout);
+            } else {
+              errno = error;
             }
+          }
 
-            if (afterTimePeriod(&period, NULL)) break;
-            if (errno != EBUSY) break;
-            asyncWait(BLUETOOTH_CHANNEL_BUSY_RETRY_INTERVAL);
+          if (connected) {
+            if (discover) bthRememberChannel(connection->address, connection->channel);
+            return connection;
           }
 
           bthRememberConnectError(connection->address, errno);
@@ -403,6 +606,7 @@ bthGetDeviceName (uint64_t bda, int timeout) {
 
       if ((entry->deviceName = bthObtainDeviceName(bda, timeout))) {
         logMessage(LOG_CATEGORY(BLUETOOTH_IO), "device name: %s", entry->deviceName);
+        bthSaveDeviceCache(bthGetDeviceQueue(1));
       } else {
         logMessage(LOG_CATEGORY(BLUETOOTH_IO), "device name not obtained");
       }
@@ -69,6 +69,12 @@
 #include <sys/time.h>
 #endif /* HAVE_SYS_SELECT_H */
 
+#include <sys/mman.h>
+
+#ifdef HAVE_SYS_EVENTFD_H
+#include <sys/eventfd.h>
+#endif /* HAVE_SYS_EVENTFD_H */
+
 #endif /* __MINGW32__ */
 
 #ifdef HAVE_ALLOCA_H
@@ -97,6 +103,11 @@
 #define BRLAPI(fun) brlapi_ ## fun
 #include "brlapi_common.h"
 
+#ifndef HAVE_MEMFD_CREATE
+/* no way to get memory which can be sealed before sharing it with the server */
+#undef BRLAPI_SHARED_WINDOW
+#endif /* HAVE_MEMFD_CREATE */
+
 #ifndef MIN
 #define MIN(a, b) (((a) < (b))? (a): (b))
 #endif /* MIN */
@@ -197,6 +208,21 @@ sem_destroy (sem_t *sem) {
 */
 #define BRL_KEYBUF_SIZE 256
 
+/** receive buffer size
+ *
+ * large enough for a few maximum-sized packets, so that a single read can
+ * fetch several packets when the server sends them in bursts
+ */
+#define BRL_INPUTBUF_SIZE (4 * (2*sizeof(uint32_t) + BRLAPI_MAXPACKETSIZE))
+
+/** pipelined requests buffer size
+ *
+ * maximum number of requests sent in pipelined mode without their reply
+ * having been received yet; sending another one first waits for the oldest
+ * reply
+ */
+#define BRL_PIPELINE_SIZE 64
+
 struct brlapi_handle_t { /* Connection-specific information */
   unsigned int brlx;
   unsigned int brly;
@@ -231,6 +257,26 @@ struct brlapi_handle_t { /* Connection-specific information */
   brlapi_keyCode_t keybuf[BRL_KEYBUF_SIZE];
   unsigned keybuf_next;
   unsigned keybuf_nb;
+  /* received but not yet parsed data, only accessed by the reading thread */
+  unsigned char inputbuf[BRL_INPUTBUF_SIZE];
+  size_t inputbuf_start;
+  size_t inputbuf_end;
+  /* pipelined mode: types of the requests whose reply is still awaited,
+   * protected by read_mutex */
+  int pipelined;
+  brlapi_packetType_t pipeline[BRL_PIPELINE_SIZE];
+  unsigned pipeline_next;
+  unsigned pipeline_nb;
+  unsigned pipeline_replies; /* number of pipelined replies consumed */
+  int pipeline_error; /* last pipelined error since the last brlapi_sync */
+  /* number of write packets sent, protected by fileDescriptor_mutex */
+  uint32_t writes;
+#ifdef BRLAPI_SHARED_WINDOW
+  /* window shared with the server, protected by fileDescriptor_mutex */
+  brlapi_sharedWindow_t *sharedWindow;
+  unsigned int sharedCells;
+  int sharedWakeup; /* where to notify the server of updates */
+#endif /* BRLAPI_SHARED_WINDOW */
   union {
     brlapi_exceptionHandler_t withoutHandle;
     brlapi__exceptionHandler_t withHandle;
@@ -269,6 +315,19 @@ static void brlapi_initializeHandle(brlapi_handle_t *handle)
   memset(handle->keybuf, 0, sizeof(handle->keybuf));
   handle->keybuf_next = 0;
   handle->keybuf_nb = 0;
+  handle->inputbuf_start = 0;
+  handle->inputbuf_end = 0;
+  handle->pipelined = 0;
+  handle->pipeline_next = 0;
+  handle->pipeline_nb = 0;
+  handle->pipeline_replies = 0;
+  handle->pipeline_error = 0;
+  handle->writes = 0;
+#ifdef BRLAPI_SHARED_WINDOW
+  handle->sharedWindow = NULL;
+  handle->sharedCells = 0;
+  handle->sharedWakeup = -1;
+#endif /* BRLAPI_SHARED_WINDOW */
   if (handle == &defaultHandle)
     handle->exceptionHandler.withoutHandle = brlapi_defaultExceptionHandler;
   else
@@ -276,6 +335,158 @@ static void brlapi_initializeHandle(brlapi_handle_t *handle)
   pthread_mutex_init(&handle->exceptionHandler_mutex, NULL);
 }
 
+/* brlapi_fillInputBuffer */
+/* Reads into the receive buffer until at least count bytes are available */
+/* On POSIX systems, each read fetches as much as the buffer can hold */
+/* Returns -1 on error (EINTR too if loop is 0 and nothing was pending), */
+/* -2 on end of file */
+static ssize_t brlapi__fillInputBuffer(brlapi_handle_t *handle, size_t count, int loop)
+{
+  size_t length = handle->inputbuf_end - handle->inputbuf_start;
+  int pending = length > 0;
+
+  if (handle->inputbuf_start) {
+    memmove(handle->inputbuf, &handle->inputbuf[handle->inputbuf_start], length);
+    handle->inputbuf_start = 0;
+    handle->inputbuf_end = length;
+  }
+
+  while (handle->inputbuf_end < count) {
+    ssize_t res;
+#ifdef __MINGW32__
+    res = brlapi_readFile(handle->fileDescriptor, &handle->inputbuf[handle->inputbuf_end], count-handle->inputbuf_end, loop || pending);
+#else /* __MINGW32__ */
+    res = read(handle->fileDescriptor, &handle->inputbuf[handle->inputbuf_end], sizeof(handle->inputbuf)-handle->inputbuf_end);
+#endif /* __MINGW32__ */
+
+    if (res<0) {
+      if ((errno!=EINTR) &&
+#ifdef EWOULDBLOCK
+	  (errno!=EWOULDBLOCK) &&
+#endif /* EWOULDBLOCK */
+	  (errno!=EAGAIN)) {
+	LibcError("read in brlapi_fillInputBuffer");
+	return -1;
+      }
+
+      if (!loop && !pending) {
+	/* Nothing read yet, report EINTR */
+	LibcError("read in brlapi_fillInputBuffer");
+	return -1;
+      }
+
+      continue;
+    }
+
+    if (res==0)
+      /* Unexpected end of file ! */
+      return -2;
+
+    handle->inputbuf_end += res;
+    pending = 1;
+  }
+
+  return handle->inputbuf_end;
+}
+
+/* brlapi_readPacketHeader */
+/* Buffered version of brlapi_readPacketHeader */
+static ssize_t brlapi__readPacketHeader(brlapi_handle_t *handle, brlapi_packetType_t *packetType)
+{
+  uint32_t header[2];
+
+  if (handle->inputbuf_end - handle->inputbuf_start < sizeof(header)) {
+    ssize_t res = brlapi__fillInputBuffer(handle, sizeof(header), 0);
+    if (res<0) return res; /* reports EINTR too */
+  }
+
+  memcpy(header, &handle->inputbuf[handle->inputbuf_start], sizeof(header));
+  handle->inputbuf_start += sizeof(header);
+
+  *packetType = ntohl(header[1]);
+  return ntohl(header[0]);
+}
+
+/* brlapi_readPacketContent */
+/* Buffered version of brlapi_readPacketContent */
+/* Any part of the packet which doesn't fit in the given buffer is discarded */
+static ssize_t brlapi__readPacketContent(brlapi_handle_t *handle, size_t packetSize, void *buf, size_t bufSize)
+{
+  unsigned char *to = buf;
+  size_t wanted = MIN(bufSize, packetSize);
+  size_t left = packetSize;
+
+  while (left) {
+    size_t count = handle->inputbuf_end - handle->inputbuf_start;
+
+    if (!count) {
+      ssize_t res = brlapi__fillInputBuffer(handle, MIN(left, sizeof(handle->inputbuf)), 1);
+      if (res<0) return res;
+      count = res;
+    }
+
+    if (count > left) count = left;
+
+    if (wanted) {
+      size_t amount = MIN(count, wanted);
+      memcpy(to, &handle->inputbuf[handle->inputbuf_start], amount);
+      to += amount;
+      wanted -= amount;
+    }
+
+    handle->inputbuf_start += count;
+    left -= count;
+  }
+
+  return packetSize;
+}
+
+/* brlapi_takePipelineReply */
+/* Checks whether an acknowledgement or error packet is the reply to a */
+/* pipelined request, and if so consumes it, reporting errors through the */
+/* exception handler */
+/* Returns 1 if the packet was consumed, 0 else */
+static int brlapi__takePipelineReply(brlapi_handle_t *handle, brlapi_packetType_t type, const brlapi_packet_t *packet, size_t size)
+{
+  const brlapi_errorPacket_t *errorPacket = &packet->error;
+  brlapi_packetType_t request;
+  int error = 0;
+
+  pthread_mutex_lock(&handle->read_mutex);
+  if (type==BRLAPI_PACKET_ERROR) {
+    error = (size>=sizeof(errorPacket->code))? ntohl(errorPacket->code): BRLAPI_ERROR_INVALID_PACKET;
+
+    if (size>=sizeof(errorPacket->code)+sizeof(errorPacket->type)) {
+      /* the server tells which request failed */
+      request = ntohl(errorPacket->type);
+      /* these never get acknowledged */
+      if ((request==BRLAPI_PACKET_WRITE) || (request==BRLAPI_PACKET_SETFOCUS)) goto report;
+      if (!handle->pipeline_nb || (handle->pipeline[handle->pipeline_next]!=request)) goto notOurs;
+    } else if (!handle->pipeline_nb) goto notOurs;
+  } else if (!handle->pipeline_nb) goto notOurs;
+
+  request = handle->pipeline[handle->pipeline_next];
+  handle->pipeline_next = (handle->pipeline_next+1)%BRL_PIPELINE_SIZE;
+  handle->pipeline_nb--;
+
+report:
+  handle->pipeline_replies++;
+  if (error) handle->pipeline_error = error;
+  pthread_mutex_unlock(&handle->read_mutex);
+
+  if (error) {
+    if (handle==&defaultHandle)
+      defaultHandle.exceptionHandler.withoutHandle(error, request, NULL, 0);
+    else
+      handle->exceptionHandler.withHandle(handle, error, request, NULL, 0);
+  }
+  return 1;
+
+notOurs:
+  pthread_mutex_unlock(&handle->read_mutex);
+  return 0;
+}
+
 /* brlapi_doWaitForPacket */
 /* Waits for the specified type of packet: must be called with brlapi_req_mutex locked */
 /* If the right packet type arrives, returns its size */
@@ -291,17 +502,37 @@ static ssize_t brlapi__doWaitForPacket(brlapi_handle_t *handle, brlapi_packetTyp
   ssize_t res;
   static const brlapi_errorPacket_t *errorPacket = &localPacket.error;
 
-  res = brlapi_readPacketHeader(handle->fileDescriptor, &type);
+  res = brlapi__readPacketHeader(handle, &type);
   if (res<0) return res; /* reports EINTR too */
+
+  if (handle->pipelined && ((type==BRLAPI_PACKET_ACK) || (type==BRLAPI_PACKET_ERROR))) {
+    /* May be the reply to a pipelined request */
+    if ((res = brlapi__readPacketContent(handle, res, &localPacket, sizeof(localPacket))) < 0) return res;
+    if (brlapi__takePipelineReply(handle, type, &localPacket, res)) return -3;
+
+    if (type==expectedPacketType) {
+      if (packet) memcpy(packet, &localPacket, MIN(size, (size_t)res));
+      return res;
+    }
+
+    if (type==BRLAPI_PACKET_ERROR) {
+      brlapi_errno = ntohl(errorPacket->code);
+      return -1;
+    }
+
+    syslog(LOG_ERR,"(brlapi_waitForPacket) Received unexpected packet of type %s and size %ld\n",brlapi_getPacketTypeName(type),(long)res);
+    return -3;
+  }
+
   if (type==expectedPacketType)
     /* For us, just read */
-    return brlapi_readPacketContent(handle->fileDescriptor, res, packet, size);
+    return brlapi__readPacketContent(handle, res, packet, size);
 
   /* Not for us. For alternate reader? */
   pthread_mutex_lock(&handle->read_mutex);
   if (handle->altSem && type==handle->altExpectedPacketType) {
     /* Yes, put packet content there */
-    *handle->altRes = res = brlapi_readPacketContent(handle->fileDescriptor, res, handle->altPacket, handle->altSize);
+    *handle->altRes = res = brlapi__readPacketContent(handle, res, handle->altPacket, handle->altSize);
 #ifndef WINDOWS
     if (sem_post)
 #endif /* WINDOWS */
@@ -312,7 +543,7 @@ static ssize_t brlapi__doWaitForPacket(brlapi_handle_t *handle, brlapi_packetTyp
     return -3;
   }
   /* No alternate reader, read it locally... */
-  if ((res = brlapi_readPacketContent(handle->fileDescriptor, res, &localPacket, sizeof(localPacket))) < 0) {
+  if ((res = brlapi__readPacketContent(handle, res, &localPacket, sizeof(localPacket))) < 0) {
     pthread_mutex_unlock(&handle->read_mutex);
     return res;
   }
@@ -321,7 +552,8 @@ static ssize_t brlapi__doWaitForPacket(brlapi_handle_t *handle, brlapi_packetTyp
     if (handle->keybuf_nb>=BRL_KEYBUF_SIZE) {
       syslog(LOG_WARNING,"lost key: 0X%8lx%8lx\n",(unsigned long)ntohl(uint32Packet[0]),(unsigned long)ntohl(uint32Packet[1]));
     } else {
-      handle->keybuf[(handle->keybuf_next+handle->keybuf_nb++)%BRL_KEYBUF_SIZE]=ntohl(*uint32Packet);
+      handle->keybuf[(handle->keybuf_next+handle->keybuf_nb++)%BRL_KEYBUF_SIZE]=
+        ((brlapi_keyCode_t)ntohl(uint32Packet[0]) << 32) | ntohl(uint32Packet[1]);
     }
     pthread_mutex_unlock(&handle->read_mutex);
     return -3;
@@ -361,6 +593,24 @@ static ssize_t brlapi__doWaitForPacket(brlapi_handle_t *handle, brlapi_packetTyp
   return -3;
 }
 
+/* brlapi_releaseReading */
+/* Gives up the reading role, telling a thread which is waiting for */
+/* another packet type that there was no packet for it */
+static void brlapi__releaseReading(brlapi_handle_t *handle)
+{
+  pthread_mutex_lock(&handle->read_mutex);
+  if (handle->altSem) {
+    *handle->altRes = -3; /* no packet for him */
+#ifndef WINDOWS
+    if (sem_post)
+#endif /* WINDOWS */
+      sem_post(handle->altSem);
+    handle->altSem = NULL;
+  }
+  handle->reading = 0;
+  pthread_mutex_unlock(&handle->read_mutex);
+}
+
 /* brlapi_waitForPacket */
 /* same as brlapi_doWaitForPacket, but sleeps instead of reading if another
  * thread is already reading. Never returns -2. If loop is 1, never returns -3.
@@ -400,17 +650,7 @@ again:
 	  brlapi_libcerrno == EWOULDBLOCK ||
 #endif /* EWOULDBLOCK */
 	  brlapi_libcerrno == EAGAIN))));
-    pthread_mutex_lock(&handle->read_mutex);
-    if (handle->altSem) {
-      *handle->altRes = -3; /* no packet for him */
-#ifndef WINDOWS
-      if (sem_post)
-#endif /* WINDOWS */
-        sem_post(handle->altSem);
-      handle->altSem = NULL;
-    }
-    handle->reading = 0;
-    pthread_mutex_unlock(&handle->read_mutex);
+    brlapi__releaseReading(handle);
   } else {
     sem_wait(&sem);
     sem_destroy(&sem);
@@ -446,6 +686,48 @@ static int brlapi__writePacketWaitForAck(brlapi_handle_t *handle, brlapi_packetT
   return res;
 }
 
+/* brlapi_writePacketPipelined */
+/* write a packet whose acknowledgement will be checked later */
+static int brlapi__writePacketPipelined(brlapi_handle_t *handle, brlapi_packetType_t type, const void *buf, size_t size)
+{
+  ssize_t res;
+  pthread_mutex_lock(&handle->req_mutex);
+
+  while (1) {
+    int full;
+
+    pthread_mutex_lock(&handle->read_mutex);
+    full = handle->pipeline_nb >= BRL_PIPELINE_SIZE;
+    pthread_mutex_unlock(&handle->read_mutex);
+    if (!full) break;
+
+    /* make room by waiting for the oldest reply */
+    res = brlapi__waitForPacket(handle, 0, NULL, 0, 0);
+    if ((res == -1) && !((brlapi_errno == BRLAPI_ERROR_LIBCERR) && (brlapi_libcerrno == EINTR))) {
+      pthread_mutex_unlock(&handle->req_mutex);
+      return -1;
+    }
+  }
+
+  /* queue the request before sending it so that its reply can't be missed */
+  pthread_mutex_lock(&handle->read_mutex);
+  handle->pipeline[(handle->pipeline_next+handle->pipeline_nb++)%BRL_PIPELINE_SIZE] = type;
+  pthread_mutex_unlock(&handle->read_mutex);
+
+  pthread_mutex_lock(&handle->fileDescriptor_mutex);
+  res = brlapi_writePacket(handle->fileDescriptor, type, buf, size);
+  pthread_mutex_unlock(&handle->fileDescriptor_mutex);
+
+  if (res<0) {
+    pthread_mutex_lock(&handle->read_mutex);
+    handle->pipeline_nb--;
+    pthread_mutex_unlock(&handle->read_mutex);
+  }
+
+  pthread_mutex_unlock(&handle->req_mutex);
+  return res;
+}
+
 /* Function: tryHost */
 /* Tries to connect to the given host. */
 static int tryHost(brlapi_handle_t *handle, char *hostAndPort) {
@@ -763,12 +1045,30 @@ brlapi_fileDescriptor BRLAPI_STDCALL brlapi_openConnection(const brlapi_connecti
 
 /* brlapi_closeConnection */
 /* Cleanly close the socket */
+#ifdef BRLAPI_SHARED_WINDOW
+/* brlapi_releaseSharedWindow */
+/* Stops sharing the window, must be called with fileDescriptor_mutex locked */
+static void brlapi__releaseSharedWindow(brlapi_handle_t *handle)
+{
+  if (handle->sharedWindow) {
+    munmap(handle->sharedWindow, BRLAPI_SHAREDWINDOW_SIZE(handle->sharedCells));
+    handle->sharedWindow = NULL;
+    handle->sharedCells = 0;
+    close(handle->sharedWakeup);
+    handle->sharedWakeup = -1;
+  }
+}
+#endif /* BRLAPI_SHARED_WINDOW */
+
 void BRLAPI_STDCALL brlapi__closeConnection(brlapi_handle_t *handle)
 {
   pthread_mutex_lock(&handle->state_mutex);
   handle->state = 0;
   pthread_mutex_unlock(&handle->state_mutex);
   pthread_mutex_lock(&handle->fileDescriptor_mutex);
+#ifdef BRLAPI_SHARED_WINDOW
+  brlapi__releaseSharedWindow(handle);
+#endif /* BRLAPI_SHARED_WINDOW */
   closeFileDescriptor(handle->fileDescriptor);
   handle->fileDescriptor = INVALID_FILE_DESCRIPTOR;
   pthread_mutex_unlock(&handle->fileDescriptor_mutex);
@@ -1114,6 +1414,12 @@ int BRLAPI_STDCALL brlapi__leaveTtyMode(brlapi_handle_t *handle)
     goto out;
   }
   handle->brlx = 0; handle->brly = 0;
+#ifdef BRLAPI_SHARED_WINDOW
+  /* the server stops using it along with the tty */
+  pthread_mutex_lock(&handle->fileDescriptor_mutex);
+  brlapi__releaseSharedWindow(handle);
+  pthread_mutex_unlock(&handle->fileDescriptor_mutex);
+#endif /* BRLAPI_SHARED_WINDOW */
   res = brlapi__writePacketWaitForAck(handle,BRLAPI_PACKET_LEAVETTYMODE,NULL,0);
   handle->state &= ~STCONTROLLINGTTY;
 out:
@@ -1180,6 +1486,105 @@ static size_t getCharset(void *buffer, int wide) {
   return p-start;
 }
 
+#ifdef BRLAPI_SHARED_WINDOW
+/* Function : brlapi_writeSharedText */
+/* Publishes text in the shared window, must be called with */
+/* fileDescriptor_mutex locked */
+/* Returns 1 if done, 0 if it has to be sent over the socket, -1 on error */
+static int brlapi__writeSharedText(brlapi_handle_t *handle, int cursor, const void *str, int wide)
+{
+  brlapi_sharedWindow_t *window = handle->sharedWindow;
+  unsigned int cells = handle->sharedCells;
+  uint32_t text[cells];
+  uint32_t sequence;
+
+  if (window->writes != handle->writes) {
+    /* write packets sent since the last update have changed the text */
+    if (!str) return 0;
+  } else if (cursor == BRLAPI_CURSOR_LEAVE) {
+    /* the previous update may get skipped, so keep its cursor */
+    cursor = window->cursor;
+  }
+
+  if (str) {
+    unsigned int count = 0;
+
+    if (wide) {
+      const wchar_t *characters = str;
+
+      while ((count < cells) && characters[count]) {
+        text[count] = characters[count];
+        count += 1;
+      }
+    } else {
+      const char *locale = setlocale(LC_CTYPE, NULL);
+
+      if (locale && strcmp(locale, "C")) {
+        const char *bytes = str;
+        size_t length = strlen(bytes);
+        mbstate_t ps;
+
+        memset(&ps, 0, sizeof(ps));
+        while ((count < cells) && *bytes) {
+          wchar_t character;
+          size_t eaten = mbrtowc(&character, bytes, length, &ps);
+
+          switch (eaten) {
+            case (size_t)(-2):
+              errno = EILSEQ;
+            case (size_t)(-1):
+              brlapi_libcerrno = errno;
+              brlapi_errfun = "mbrtowc";
+              brlapi_errno = BRLAPI_ERROR_LIBCERR;
+              return -1;
+          }
+
+          text[count++] = character;
+          bytes += eaten;
+          length -= eaten;
+        }
+      } else {
+        const unsigned char *bytes = str;
+
+        while ((count < cells) && bytes[count]) {
+          text[count] = bytes[count];
+          count += 1;
+        }
+      }
+    }
+
+    while (count < cells) text[count++] = ' ';
+  }
+
+  sequence = window->sequence;
+  window->sequence = sequence + 1;
+  brlapi_memoryBarrier();
+  if (str) memcpy(window->text, text, sizeof(text));
+  window->cursor = cursor;
+  window->writes = handle->writes;
+  brlapi_memoryBarrier();
+  window->sequence = sequence + 2;
+  brlapi_memoryBarrier();
+
+  /* if the server hasn't looked at the previous update yet, it has already */
+  /* been notified and will see this one instead */
+  if (window->consumed == sequence) {
+#ifdef HAVE_SYS_EVENTFD_H
+    uint64_t value = 1;
+#else /* HAVE_SYS_EVENTFD_H */
+    unsigned char value = 1;
+#endif /* HAVE_SYS_EVENTFD_H */
+
+    if ((write(handle->sharedWakeup, &value, sizeof(value)) == -1) && (errno != EAGAIN)) {
+      LibcError("write in writeSharedText");
+      return -1;
+    }
+  }
+
+  return 1;
+}
+#endif /* BRLAPI_SHARED_WINDOW */
+
 /* Function : brlapi_writeText */
 /* Writes a string to the braille display */
 static int brlapi___writeText(brlapi_handle_t *handle, int cursor, const void *str, int wide)
@@ -1192,6 +1597,12 @@ static int brlapi___writeText(brlapi_handle_t *handle, int cursor, const void *s
   char *locale;
   int res;
   size_t len;
+#ifdef BRLAPI_SHARED_WINDOW
+  pthread_mutex_lock(&handle->fileDescriptor_mutex);
+  res = handle->sharedWindow? brlapi__writeSharedText(handle, cursor, str, wide): 0;
+  pthread_mutex_unlock(&handle->fileDescriptor_mutex);
+  if (res) return (res < 0)? -1: 0;
+#endif /* BRLAPI_SHARED_WINDOW */
   locale = setlocale(LC_CTYPE,NULL);
   wa->flags = BRLAPI_WF_REGION;
   *((uint32_t *) p) = htonl(1); p += sizeof(uint32_t);
@@ -1268,6 +1679,7 @@ endcount:
   wa->flags = htonl(wa->flags);
   pthread_mutex_lock(&handle->fileDescriptor_mutex);
   res = brlapi_writePacket(handle->fileDescriptor,BRLAPI_PACKET_WRITE,&packet,sizeof(wa->flags)+(p-&wa->data));
+  if (res>=0) handle->writes++;
   pthread_mutex_unlock(&handle->fileDescriptor_mutex);
   return res;
 }
@@ -1444,10 +1856,246 @@ send:
   wa->flags = htonl(wa->flags);
   pthread_mutex_lock(&handle->fileDescriptor_mutex);
   res = brlapi_writePacket(handle->fileDescriptor,BRLAPI_PACKET_WRITE,&packet,sizeof(wa->flags)+(p-&wa->data));
+  if (res>=0) handle->writes++;
   pthread_mutex_unlock(&handle->fileDescriptor_mutex);
   return res;
 }
 
+/* Function : brlapi_sync */
+/* Waits for all the requests sent so far to have been handled */
+int BRLAPI_STDCALL brlapi__sync(brlapi_handle_t *handle)
+{
+  char name[BRLAPI_MAXPACKETSIZE];
+  int error;
+
+  /* the server handles requests in order, so any reply will do */
+  if (brlapi__request(handle, BRLAPI_PACKET_GETDRIVERNAME, name, sizeof(name)) < 0)
+    return -1;
+
+  pthread_mutex_lock(&handle->read_mutex);
+  error = handle->pipeline_error;
+  handle->pipeline_error = 0;
+  pthread_mutex_unlock(&handle->read_mutex);
+
+  if (error) {
+    brlapi_errno = error;
+    return -1;
+  }
+  return 0;
+}
+
+int BRLAPI_STDCALL brlapi_sync(void)
+{
+  return brlapi__sync(&defaultHandle);
+}
+
+/* Function : brlapi_setPipelining */
+/* Enables or disables pipelined requests */
+int BRLAPI_STDCALL brlapi__setPipelining(brlapi_handle_t *handle, int enable)
+{
+  int res = 0;
+
+  if (!enable && handle->pipelined) {
+    /* pending replies must be taken while they can still be recognized */
+    res = brlapi__sync(handle);
+  }
+
+  handle->pipelined = !!enable;
+  return res;
+}
+
+int BRLAPI_STDCALL brlapi_setPipelining(int enable)
+{
+  return brlapi__setPipelining(&defaultHandle, enable);
+}
+
+#ifdef BRLAPI_SHARED_WINDOW
+/* Function : brlapi_createSharedMemory */
+/* Returns a descriptor of anonymous memory which can be passed to the server */
+static int brlapi_createSharedMemory(size_t size)
+{
+  int memory;
+
+  if ((memory = memfd_create("brlapi-window", MFD_CLOEXEC | MFD_ALLOW_SEALING)) == -1) {
+    LibcError("memfd_create");
+    return -1;
+  }
+
+  if (ftruncate(memory, size) == -1) {
+    LibcError("ftruncate");
+    goto error;
+  }
+
+  /* the server accesses it safely only if it can't be shrunk */
+  if (fcntl(memory, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) == -1) {
+    LibcError("fcntl[F_ADD_SEALS]");
+    goto error;
+  }
+
+  return memory;
+
+error:
+  close(memory);
+  return -1;
+}
+
+/* Function : brlapi_writePacketWithDescriptors */
+/* Writes a packet along with file descriptors for the server to receive */
+static int brlapi__writePacketWithDescriptors(brlapi_handle_t *handle, brlapi_packetType_t type, const void *buf, size_t size, const int *descriptors, unsigned int count)
+{
+  unsigned char data[2*sizeof(uint32_t) + size];
+  uint32_t header[2] = { htonl(size), htonl(type) };
+  struct iovec iov;
+  union {
+    struct cmsghdr header;
+    char buffer[CMSG_SPACE(BRLAPI_MAXDESCRIPTORS * sizeof(int))];
+  } control;
+  struct msghdr msg;
+  struct cmsghdr *cmsg;
+  ssize_t res;
+
+  memcpy(data, header, sizeof(header));
+  memcpy(&data[sizeof(header)], buf, size);
+  iov.iov_base = data;
+  iov.iov_len = sizeof(data);
+
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buffer;
+  msg.msg_controllen = CMSG_SPACE(count * sizeof(int));
+
+  cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(count * sizeof(int));
+  memcpy(CMSG_DATA(cmsg), descriptors, count * sizeof(int));
+
+  pthread_mutex_lock(&handle->fileDescriptor_mutex);
+  do {
+    res = sendmsg(handle->fileDescriptor, &msg, 0);
+  } while ((res == -1) && (errno == EINTR));
+
+  /* the descriptors went along with the first byte */
+  if ((res >= 0) && (res < sizeof(data)))
+    if (brlapi_writeFile(handle->fileDescriptor, &data[res], sizeof(data)-res) < 0) res = -1;
+  pthread_mutex_unlock(&handle->fileDescriptor_mutex);
+
+  if (res < 0) {
+    LibcError("sendmsg in writePacketWithDescriptors");
+    return -1;
+  }
+  return 0;
+}
+#endif /* BRLAPI_SHARED_WINDOW */
+
+/* Function : brlapi_shareWindow */
+/* Publishes the window to the server through shared memory */
+int BRLAPI_STDCALL brlapi__shareWindow(brlapi_handle_t *handle)
+{
+#ifdef BRLAPI_SHARED_WINDOW
+  unsigned int cells, i;
+  size_t size;
+  brlapi_sharedWindow_t *window;
+  brlapi_packet_t packet;
+  int descriptors[BRLAPI_MAXDESCRIPTORS];
+  int memory, wakeup;
+  int res = -1;
+
+  pthread_mutex_lock(&handle->state_mutex);
+  if (!(handle->state & STCONTROLLINGTTY)) {
+    brlapi_errno = BRLAPI_ERROR_ILLEGAL_INSTRUCTION;
+    goto out;
+  }
+  if (handle->addrfamily != PF_LOCAL) {
+    brlapi_errno = BRLAPI_ERROR_OPNOTSUPP;
+    goto out;
+  }
+  if (handle->sharedWindow) {
+    res = 0;
+    goto out;
+  }
+
+  cells = handle->brlx * handle->brly;
+  size = BRLAPI_SHAREDWINDOW_SIZE(cells);
+  if ((memory = brlapi_createSharedMemory(size)) == -1) goto out;
+
+  window = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, memory, 0);
+  if (window == MAP_FAILED) {
+    LibcError("mmap in shareWindow");
+    goto noMap;
+  }
+
+  window->magic = BRLAPI_SHAREDWINDOW_MAGIC;
+  window->cells = cells;
+  window->sequence = 0;
+  window->consumed = 0;
+  window->cursor = BRLAPI_CURSOR_LEAVE;
+  for (i=0; i<cells; i++) window->text[i] = ' ';
+
+#ifdef HAVE_SYS_EVENTFD_H
+  if ((wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1) {
+    LibcError("eventfd in shareWindow");
+    goto noWakeup;
+  }
+  descriptors[1] = wakeup;
+#else /* HAVE_SYS_EVENTFD_H */
+  {
+    int pipeDescriptors[2];
+
+    if (pipe(pipeDescriptors) == -1) {
+      LibcError("pipe in shareWindow");
+      goto noWakeup;
+    }
+    fcntl(pipeDescriptors[1], F_SETFL, O_NONBLOCK);
+    descriptors[1] = pipeDescriptors[0];
+    wakeup = pipeDescriptors[1];
+  }
+#endif /* HAVE_SYS_EVENTFD_H */
+  descriptors[0] = memory;
+
+  packet.shareWindow.cells = htonl(cells);
+  pthread_mutex_lock(&handle->req_mutex);
+  res = brlapi__writePacketWithDescriptors(handle, BRLAPI_PACKET_SHAREWINDOW, &packet, sizeof(packet.shareWindow), descriptors, 2);
+  if (res >= 0) res = brlapi__waitForAck(handle);
+  pthread_mutex_unlock(&handle->req_mutex);
+
+  if (descriptors[1] != wakeup) close(descriptors[1]);
+  close(memory);
+
+  if (res < 0) {
+    close(wakeup);
+    munmap(window, size);
+    goto out;
+  }
+
+  pthread_mutex_lock(&handle->fileDescriptor_mutex);
+  /* the first update can't rely on text written so far */
+  window->writes = handle->writes - 1;
+  handle->sharedWindow = window;
+  handle->sharedCells = cells;
+  handle->sharedWakeup = wakeup;
+  pthread_mutex_unlock(&handle->fileDescriptor_mutex);
+  goto out;
+
+noWakeup:
+  munmap(window, size);
+noMap:
+  close(memory);
+out:
+  pthread_mutex_unlock(&handle->state_mutex);
+  return res;
+#else /* BRLAPI_SHARED_WINDOW */
+  brlapi_errno = BRLAPI_ERROR_OPNOTSUPP;
+  return -1;
+#endif /* BRLAPI_SHARED_WINDOW */
+}
+
+int BRLAPI_STDCALL brlapi_shareWindow(void)
+{
+  return brlapi__shareWindow(&defaultHandle);
+}
+
 #ifdef WINDOWS
 int BRLAPI_STDCALL brlapi_writeWin(const brlapi_writeArguments_t *s, int wide)
 {
@@ -1464,8 +2112,18 @@ int brlapi_write(const brlapi_writeArguments_t *s)
 /* Tests wether a packet is ready on file descriptor fd */
 /* Returns -1 if an error occurs, 0 if no packet is ready, 1 if there is a */
 /* packet ready to be read */
-static int packetReady(brlapi_handle_t *handle)
+static int doPacketReady(brlapi_handle_t *handle)
 {
+  {
+    size_t length = handle->inputbuf_end - handle->inputbuf_start;
+    uint32_t header[2];
+
+    if (length >= sizeof(header)) {
+      memcpy(header, &handle->inputbuf[handle->inputbuf_start], sizeof(header));
+      if (length - sizeof(header) >= ntohl(header[0])) return 1;
+    }
+  }
+
 #ifdef __MINGW32__
   if (handle->addrfamily == PF_LOCAL) {
     DWORD avail;
@@ -1492,12 +2150,31 @@ static int packetReady(brlapi_handle_t *handle)
 #endif /* __MINGW32__ */
 }
 
-/* Function : brlapi_readKey */
-/* Reads a key from the braille keyboard */
-int BRLAPI_STDCALL brlapi__readKey(brlapi_handle_t *handle, int block, brlapi_keyCode_t *code)
+/* The input buffer may only be looked at by the thread which is reading. */
+/* If another one is, any key which it reads is buffered for us later, so */
+/* there's nothing ready yet. */
+static int packetReady(brlapi_handle_t *handle)
+{
+  int reading;
+  int res;
+
+  pthread_mutex_lock(&handle->read_mutex);
+  if (!(reading = handle->reading)) handle->reading = 1;
+  pthread_mutex_unlock(&handle->read_mutex);
+  if (reading) return 0;
+
+  res = doPacketReady(handle);
+  brlapi__releaseReading(handle);
+  return res;
+}
+
+/* Function : brlapi_readKeys */
+/* Reads the keys available from the braille keyboard */
+int BRLAPI_STDCALL brlapi__readKeys(brlapi_handle_t *handle, int block, brlapi_keyCode_t *codes, unsigned int count)
 {
   ssize_t res;
   uint32_t buf[2];
+  int n = 0;
 
   pthread_mutex_lock(&handle->state_mutex);
   if (!(handle->state & STCONTROLLINGTTY)) {
@@ -1508,37 +2185,64 @@ int BRLAPI_STDCALL brlapi__readKey(brlapi_handle_t *handle, int block, brlapi_ke
   pthread_mutex_unlock(&handle->state_mutex);
 
   pthread_mutex_lock(&handle->read_mutex);
-  if (handle->keybuf_nb>0) {
-    *code=handle->keybuf[handle->keybuf_next];
+  while ((n < count) && (handle->keybuf_nb>0)) {
+    codes[n++]=handle->keybuf[handle->keybuf_next];
     handle->keybuf_next=(handle->keybuf_next+1)%BRL_KEYBUF_SIZE;
     handle->keybuf_nb--;
-    pthread_mutex_unlock(&handle->read_mutex);
-    return 1;
   }
   pthread_mutex_unlock(&handle->read_mutex);
+  if (n == count) return n;
 
   pthread_mutex_lock(&handle->key_mutex);
-  if (!block) {
-    res = packetReady(handle);
-    if (res<=0) {
-      if (res<0)
-	brlapi_errno = BRLAPI_ERROR_LIBCERR;
-      pthread_mutex_unlock(&handle->key_mutex);
-      return res;
+  while (n < count) {
+    unsigned replies = handle->pipeline_replies;
+
+    /* once there is a key, only take those which have already arrived */
+    if (!block || n) {
+      res = packetReady(handle);
+      if (res<=0) {
+        if ((res<0) && !n) {
+	  brlapi_errno = BRLAPI_ERROR_LIBCERR;
+          n = -1;
+        }
+        break;
+      }
     }
+    res=brlapi__waitForPacket(handle,BRLAPI_PACKET_KEY, buf, sizeof(buf), 0);
+
+    if (res == -3) {
+      /* the reply to a pipelined request isn't an interruption */
+      if (handle->pipeline_replies != replies) continue;
+
+      if (block && !n) {
+        brlapi_libcerrno = EINTR;
+        brlapi_errno = BRLAPI_ERROR_LIBCERR;
+        brlapi_errfun = "waitForPacket";
+        n = -1;
+      }
+      break;
+    }
+
+    if (res < 0) {
+      if (!n) n = -1;
+      break;
+    }
+    codes[n++] = ((brlapi_keyCode_t)ntohl(buf[0]) << 32) | ntohl(buf[1]);
   }
-  res=brlapi__waitForPacket(handle,BRLAPI_PACKET_KEY, buf, sizeof(buf), 0);
   pthread_mutex_unlock(&handle->key_mutex);
-  if (res == -3) {
-    if (!block) return 0;
-    brlapi_libcerrno = block?EINTR:EAGAIN;
-    brlapi_errno = BRLAPI_ERROR_LIBCERR;
-    brlapi_errfun = "waitForPacket";
-    return -1;
-  }
-  if (res < 0) return -1;
-  *code = ((brlapi_keyCode_t)ntohl(buf[0]) << 32) | ntohl(buf[1]);
-  return 1;
+  return n;
+}
+
+int BRLAPI_STDCALL brlapi_readKeys(int block, brlapi_keyCode_t *codes, unsigned int count)
+{
+  return brlapi__readKeys(&defaultHandle, block, codes, count);
+}
+
+/* Function : brlapi_readKey */
+/* Reads a key from the braille keyboard */
+int BRLAPI_STDCALL brlapi__readKey(brlapi_handle_t *handle, int block, brlapi_keyCode_t *code)
+{
+  return brlapi__readKeys(handle, block, code, 1);
 }
 
 int BRLAPI_STDCALL brlapi_readKey(int block, brlapi_keyCode_t *code)
@@ -1709,8 +2413,16 @@ static int ignore_accept_key_ranges(brlapi_handle_t *handle, int what, brlapi_ra
     todo = remaining;
     if (todo > BRLAPI_MAXPACKETSIZE / (2*sizeof(brlapi_keyCode_t)))
       todo = BRLAPI_MAXPACKETSIZE / (2*sizeof(brlapi_keyCode_t));
-    if (brlapi__writePacketWaitForAck(handle,(what ? BRLAPI_PACKET_ACCEPTKEYRANGES : BRLAPI_PACKET_IGNOREKEYRANGES),&ints[n-remaining],todo*2*sizeof(brlapi_keyCode_t)))
-      return -1;
+    brlapi_packetType_t type = what ? BRLAPI_PACKET_ACCEPTKEYRANGES : BRLAPI_PACKET_IGNOREKEYRANGES;
+    size_t size = todo*2*sizeof(brlapi_keyCode_t);
+
+    if (handle->pipelined) {
+      if (brlapi__writePacketPipelined(handle,type,&ints[n-remaining],size))
+        return -1;
+    } else {
+      if (brlapi__writePacketWaitForAck(handle,type,&ints[n-remaining],size))
+        return -1;
+    }
   }
   return 0;
 }
@@ -1938,7 +2650,7 @@ int BRLAPI_STDCALL brlapi__strexception(brlapi_handle_t *handle, char *buf, size
   brlapi_error_t error = { .brlerrno = err };
   for (i=0; i<nbChars; i++)
     p += sprintf(p, "%02x ", ((unsigned char *) packet)[i]);
-  p--; /* Don't keep last space */
+  if (p != hexString) p--; /* Don't keep last space */
   *p = '\0';
   return snprintf(buf, n, "%s on %s request of size %d (%s)",
     brlapi_strerror(&error), brlapi_getPacketTypeName(type), (int)size, hexString);
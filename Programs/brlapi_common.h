@@ -30,6 +30,7 @@
 #include <io.h>
 #else /* __MINGW32__ */
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -43,6 +44,19 @@
 #define PF_LOCAL PF_UNIX
 #endif /* !defined(PF_LOCAL) && defined(PF_UNIX) */
 
+/* windows can be shared only by passing file descriptors over local sockets,
+ * and only through memory which can be sealed against being shrunk
+ */
+#if defined(PF_LOCAL) && defined(SCM_RIGHTS) && defined(F_GET_SEALS)
+#define BRLAPI_SHARED_WINDOW
+
+/* orders accesses to a shared window against the other side's */
+#define brlapi_memoryBarrier() __sync_synchronize()
+
+/* maximum number of file descriptors passed along with a packet */
+#define BRLAPI_MAXDESCRIPTORS 2
+#endif /* defined(PF_LOCAL) && defined(SCM_RIGHTS) && defined(F_GET_SEALS) */
+
 #ifndef MIN
 #define MIN(a, b) (((a) < (b))? (a): (b))
 #endif /* MIN */
@@ -143,25 +157,97 @@ static ssize_t brlapi_readFile(brlapi_fileDescriptor fd, void *buffer, size_t si
   return n;
 }
 
+#ifndef __MINGW32__
+/* brlapi_writeFileVector */
+/* Writes a vector of buffers to a file, in a single system call if possible */
+static ssize_t brlapi_writeFileVector(brlapi_fileDescriptor fd, const struct iovec *iov, int count)
+{
+  struct msghdr msg;
+  size_t n = 0;
+  ssize_t res;
+  int i;
+
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = (struct iovec *)iov;
+  msg.msg_iovlen = count;
+
+  do {
+    res=sendmsg(fd,&msg,0);
+  } while ((res<0) &&
+           ((errno==EINTR) ||
+#ifdef EWOULDBLOCK
+            (errno==EWOULDBLOCK) ||
+#endif /* EWOULDBLOCK */
+            (errno==EAGAIN))); /* EAGAIN shouldn't happen, but who knows... */
+  if (res<0) return res;
+
+  /* on a short write, send the rest buffer by buffer */
+  for (i=0; i<count; i+=1) {
+    size_t length = iov[i].iov_len;
+
+    if ((size_t)res >= length) {
+      res -= length;
+    } else {
+      if (brlapi_writeFile(fd,(const unsigned char *)iov[i].iov_base+res,length-res)<0) return -1;
+      res = 0;
+    }
+
+    n += length;
+  }
+  return n;
+}
+#endif /* __MINGW32__ */
+
 /* brlapi_writePacket */
 /* Write a packet on the socket */
+/* The header and the data are sent together so that they don't end up in */
+/* separate TCP segments */
 ssize_t BRLAPI(writePacket)(brlapi_fileDescriptor fd, brlapi_packetType_t type, const void *buf, size_t size)
 {
   uint32_t header[2] = { htonl(size), htonl(type) };
   ssize_t res;
 
-  /* first send packet header (size+type) */
-  if ((res=brlapi_writeFile(fd,&header[0],sizeof(header)))<0) {
-    LibcError("write in writePacket");
-    return res;
-  }
+  /* without a buffer only the header is sent */
+  if (!buf) size = 0;
+
+#ifdef __MINGW32__
+  if (size <= BRLAPI_MAXPACKETSIZE) {
+    unsigned char packet[sizeof(header) + BRLAPI_MAXPACKETSIZE];
+    memcpy(packet, header, sizeof(header));
+    if (size) memcpy(&packet[sizeof(header)], buf, size);
+
+    if ((res=brlapi_writeFile(fd,packet,sizeof(header)+size))<0) {
+      LibcError("write in writePacket");
+      return res;
+    }
+  } else {
+    /* first send packet header (size+type) */
+    if ((res=brlapi_writeFile(fd,&header[0],sizeof(header)))<0) {
+      LibcError("write in writePacket");
+      return res;
+    }
 
-  /* eventually data */
-  if (size && buf)
+    /* then data */
     if ((res=brlapi_writeFile(fd,buf,size))<0) {
       LibcError("write in writePacket");
       return res;
     }
+  }
+#else /* __MINGW32__ */
+  {
+    struct iovec iov[2];
+
+    iov[0].iov_base = header;
+    iov[0].iov_len = sizeof(header);
+    iov[1].iov_base = (void *)buf;
+    iov[1].iov_len = size;
+
+    if ((res=brlapi_writeFileVector(fd,iov,2))<0) {
+      LibcError("write in writePacket");
+      return res;
+    }
+  }
+#endif /* __MINGW32__ */
 
   return 0;
 }
@@ -339,6 +425,7 @@ static const brlapi_packetTypeEntry_t brlapi_packetTypeTable[] = {
   { BRLAPI_PACKET_PACKET, "Packet" },
   { BRLAPI_PACKET_SUSPENDDRIVER, "SuspendDriver" },
   { BRLAPI_PACKET_RESUMEDRIVER, "ResumeDriver" },
+  { BRLAPI_PACKET_SHAREWINDOW, "ShareWindow" },
   { BRLAPI_PACKET_ACK, "Ack" },
   { BRLAPI_PACKET_ERROR, "Error" },
   { BRLAPI_PACKET_EXCEPTION, "Exception" },
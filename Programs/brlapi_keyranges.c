@@ -26,69 +26,133 @@
 #include "brlapi_keyranges.h"
 #include "log.h"
 
-static int inKeyrange(KeyrangeList *l, KeyrangeElem e)
+static int inKeyrange(const Keyrange *r, KeyrangeElem e)
 {
   uint32_t flags = KeyrangeFlags(e);
   uint32_t val = KeyrangeVal(e);
-  return (l->minVal <= val && val <= l->maxVal && (flags | l->minFlags) == flags && ((flags & ~l->maxFlags) == 0));
+  return (r->minVal <= val && val <= r->maxVal && (flags | r->minFlags) == flags && ((flags & ~r->maxFlags) == 0));
 }
 
-/* Function : createKeyrange */
-static KeyrangeList **createKeyrange(KeyrangeList **p, uint32_t minFlags, uint32_t minVal, uint32_t maxFlags, uint32_t maxVal, KeyrangeList *n)
+/* Function : allocateKeyrangeList */
+static KeyrangeList *allocateKeyrangeList(void)
 {
-  KeyrangeList *c = malloc(sizeof(KeyrangeList));
-  if (c==NULL) return NULL;
-  c->minFlags = minFlags; c->minVal = minVal;
-  c->maxFlags = maxFlags; c->maxVal = maxVal;
-  c->next = n;
-  *p = c;
-  return &c->next;
+  KeyrangeList *l = malloc(sizeof(KeyrangeList));
+  if (l==NULL) return NULL;
+  l->ranges = NULL;
+  l->reach = NULL;
+  l->count = 0;
+  l->size = 0;
+  return l;
 }
 
-/* Function : freeKeyrange */
-static void freeKeyrange(KeyrangeList **p, KeyrangeList *c)
+/* Function : reserveKeyranges */
+/* Makes sure that count more ranges can be appended to the list */
+static int reserveKeyranges(KeyrangeList *l, unsigned int count)
 {
-  if (c==NULL) return;
-  *p = c->next;
-  free(c);
+  if (l->count + count > l->size) {
+    unsigned int newSize = l->size? l->size: 8;
+    Keyrange *newRanges;
+    uint32_t *newReach;
+
+    while (newSize < l->count + count) newSize <<= 1;
+
+    if (!(newRanges = realloc(l->ranges, newSize * sizeof(*newRanges)))) return -1;
+    l->ranges = newRanges;
+
+    if (!(newReach = realloc(l->reach, newSize * sizeof(*newReach)))) return -1;
+    l->reach = newReach;
+
+    l->size = newSize;
+  }
+
+  return 0;
+}
+
+/* Function : appendKeyrange */
+static int appendKeyrange(KeyrangeList *l, uint32_t minFlags, uint32_t minVal, uint32_t maxFlags, uint32_t maxVal)
+{
+  Keyrange *r;
+  if (reserveKeyranges(l, 1) == -1) return -1;
+  r = &l->ranges[l->count++];
+  r->minFlags = minFlags; r->minVal = minVal;
+  r->maxFlags = maxFlags; r->maxVal = maxVal;
+  return 0;
+}
+
+/* Function : indexKeyrangeList */
+/* Restores the ordering by minVal and recomputes the reach of each range */
+/* The list is nearly sorted after an update, so insertion sort is cheap */
+static void indexKeyrangeList(KeyrangeList *l)
+{
+  unsigned int i;
+
+  for (i=1; i<l->count; i++) {
+    Keyrange r = l->ranges[i];
+    unsigned int j = i;
+
+    while (j > 0 && l->ranges[j-1].minVal > r.minVal) {
+      l->ranges[j] = l->ranges[j-1];
+      j -= 1;
+    }
+
+    l->ranges[j] = r;
+  }
+
+  for (i=0; i<l->count; i++) {
+    uint32_t maxVal = l->ranges[i].maxVal;
+    l->reach[i] = (i && (l->reach[i-1] > maxVal))? l->reach[i-1]: maxVal;
+  }
 }
 
 /* Function : freeKeyrangeList */
 void freeKeyrangeList(KeyrangeList **l)
 {
-  KeyrangeList *p1, *p2;
   if (l==NULL) return;
-  p2 = *l;
-  while (p2!=NULL) {
-    p1 = p2;
-    p2 = p1->next;
-    free(p1);
+  if (*l!=NULL) {
+    free((*l)->ranges);
+    free((*l)->reach);
+    free(*l);
   }
   *l = NULL;
 }
 
 /* Function : inKeyrangeList */
-KeyrangeList *inKeyrangeList(KeyrangeList *l, KeyrangeElem n)
+const Keyrange *inKeyrangeList(const KeyrangeList *l, KeyrangeElem n)
 {
-  KeyrangeList *c = l;
-  while (c!=NULL) {
-    if (inKeyrange(c, n)) return c;
-    c = c->next;
+  uint32_t val = KeyrangeVal(n);
+  unsigned int first = 0;
+  unsigned int last;
+
+  if (l==NULL) return NULL;
+  last = l->count;
+
+  /* find the first range starting above val */
+  while (first < last) {
+    unsigned int current = (first + last) / 2;
+    if (l->ranges[current].minVal <= val) first = current + 1;
+    else last = current;
   }
+
+  /* only ranges before it, and which reach val, may contain it */
+  while (first > 0) {
+    const Keyrange *r = &l->ranges[--first];
+    if (l->reach[first] < val) break;
+    if (inKeyrange(r, n)) return r;
+  }
+
   return NULL;
 }
 
 /* Function : DisplayKeyrangeList */
-void DisplayKeyrangeList(KeyrangeList *l)
+void DisplayKeyrangeList(const KeyrangeList *l)
 {
-  if (l==NULL) printf("emptyset");
+  if ((l==NULL) || !l->count) printf("emptyset");
   else {
-    KeyrangeList *c = l;
-    while (1) {
+    unsigned int i;
+    for (i=0; i<l->count; i++) {
+      const Keyrange *c = &l->ranges[i];
+      if (i) printf(",");
       printf("[%lx(%lx)..%lx(%lx)]",(unsigned long)c->minVal,(unsigned long)c->minFlags,(unsigned long)c->maxVal,(unsigned long)c->maxFlags);
-      if (c->next==NULL) break;
-      printf(",");
-      c = c->next;
     }
   }
   printf("\n");
@@ -97,7 +161,8 @@ void DisplayKeyrangeList(KeyrangeList *l)
 /* Function : addKeyrange */
 int addKeyrange(KeyrangeElem x0, KeyrangeElem y0, KeyrangeList **l)
 {
-  KeyrangeList *c;
+  KeyrangeList *list;
+  unsigned int i;
   uint32_t minFlags = KeyrangeFlags(x0) & KeyrangeFlags(y0);
   uint32_t maxFlags = KeyrangeFlags(x0) | KeyrangeFlags(y0);
   uint32_t minVal   = MIN(KeyrangeVal(x0), KeyrangeVal(y0));
@@ -107,8 +172,14 @@ int addKeyrange(KeyrangeElem x0, KeyrangeElem y0, KeyrangeList **l)
 
   logMessage(LOG_DEBUG, "adding range [%"PRIx32"(%"PRIx32")..%"PRIx32"(%"PRIx32")]", minVal, minFlags, maxVal, maxFlags);
 
-  c = *l;
-  while (c) {
+  if (!(list = *l)) {
+    if (!(list = allocateKeyrangeList())) return -1;
+    *l = list;
+  }
+
+  for (i=0; i<list->count; i++) {
+    Keyrange *c = &list->ranges[i];
+
     if (inKeyrange(c, min) && inKeyrange(c, max))
       /* Falls completely within an existing range */
       return 0;
@@ -117,6 +188,7 @@ int addKeyrange(KeyrangeElem x0, KeyrangeElem y0, KeyrangeList **l)
       /* May just change lower bound */
       /* Note that minVal can't be >= c->minVal */
       c->minVal = minVal;
+      indexKeyrangeList(list);
       return 0;
     }
 
@@ -124,14 +196,14 @@ int addKeyrange(KeyrangeElem x0, KeyrangeElem y0, KeyrangeList **l)
       /* May just change upper bound */
       /* Note that maxVal can't be <= c->maxVal */
       c->maxVal = maxVal;
+      indexKeyrangeList(list);
       return 0;
     }
-
-    c = c->next;
   }
 
   /* Else things are not easy, just add */
-  if ((createKeyrange(l,minFlags,minVal,maxFlags,maxVal,*l)) == NULL) return -1;
+  if (appendKeyrange(list,minFlags,minVal,maxFlags,maxVal) == -1) return -1;
+  indexKeyrangeList(list);
   return 0;
 }
 
@@ -141,89 +213,93 @@ int removeKeyrange(KeyrangeElem x0, KeyrangeElem y0, KeyrangeList **l)
   uint32_t maxFlags = KeyrangeFlags(x0) | KeyrangeFlags(y0);
   uint32_t minVal   = MIN(KeyrangeVal(x0), KeyrangeVal(y0));
   uint32_t maxVal   = MAX(KeyrangeVal(x0), KeyrangeVal(y0));
-  KeyrangeList *c, **p, *tmp;
-  int i;
+  KeyrangeList *list;
+  KeyrangeList result = { .ranges = NULL, .reach = NULL, .count = 0, .size = 0 };
+  unsigned int i;
+  int j;
 
-  if ((l==NULL) || (*l==NULL)) return 0;
+  if ((l==NULL) || ((list = *l)==NULL) || !list->count) return 0;
 
   logMessage(LOG_DEBUG, "removing range [%"PRIx32"(%"PRIx32")..%"PRIx32"(%"PRIx32")]", minVal, minFlags, maxVal, maxFlags);
 
   /* Need to intersect with every range */
-  p = l; c = *p;
-  while (c) {
-    if (c->minVal > maxVal || c->maxVal < minVal ||
-        !(c->maxFlags | ~minFlags) || !(~c->minFlags | maxFlags)) {
+  /* The remaining parts are collected into a new list */
+  for (i=0; i<list->count; i++) {
+    Keyrange c = list->ranges[i];
+
+    if (c.minVal > maxVal || c.maxVal < minVal ||
+        !(c.maxFlags | ~minFlags) || !(~c.minFlags | maxFlags)) {
       /* don't intersect */
-      p = &c->next;
-      c = *p;
+      if (appendKeyrange(&result, c.minFlags, c.minVal, c.maxFlags, c.maxVal) == -1) goto error;
       continue;
     }
 
-    if (minVal <= c->minVal && maxVal >= c->maxVal &&
-        (c->minFlags | minFlags) == c->minFlags &&
-        (c->maxFlags & ~maxFlags) == 0) {
+    if (minVal <= c.minVal && maxVal >= c.maxVal &&
+        (c.minFlags | minFlags) == c.minFlags &&
+        (c.maxFlags & ~maxFlags) == 0) {
       /* range falls completely in deletion range, just drop it */
-      tmp = c; c = c->next;
-      freeKeyrange(p,tmp);
       continue;
     }
 
     /* Partly intersect */
 
-    if (c->minVal < minVal) {
+    if (c.minVal < minVal) {
       /* lower part should be kept intact, save it. */
-      p = createKeyrange(p, c->minFlags, c->minVal, c->maxFlags, minVal - 1, c);
-      if (p == NULL) return -1;
-      c->minVal = minVal;
+      if (appendKeyrange(&result, c.minFlags, c.minVal, c.maxFlags, minVal - 1) == -1) goto error;
+      c.minVal = minVal;
     }
 
-    if (c->maxVal > maxVal) {
+    if (c.maxVal > maxVal) {
       /* upper part should be kept intact, save it. */
-      p = createKeyrange(p, c->minFlags, maxVal + 1, c->maxFlags, c->maxVal, c);
-      if (p == NULL) return -1;
-      c->maxVal = maxVal;
+      if (appendKeyrange(&result, c.minFlags, maxVal + 1, c.maxFlags, c.maxVal) == -1) goto error;
+      c.maxVal = maxVal;
     }
 
     /* Now values are the same, tinker with flags */
-    for (i=0; i<32; i++) {
-      uint32_t mask = 1<<i;
+    for (j=0; j<32; j++) {
+      uint32_t mask = 1<<j;
 
-      if ((!(c->maxFlags & mask) &&  (minFlags & mask)) ||
-          ( (c->minFlags & mask) && !(maxFlags & mask)))
+      if ((!(c.maxFlags & mask) &&  (minFlags & mask)) ||
+          ( (c.minFlags & mask) && !(maxFlags & mask)))
 	/* don't intersect on this flag */
 	continue;
 
-      if (!(c->minFlags & mask) &&  (minFlags & mask)) {
-        /* && (c->maxFlags & mask) */
-	/* part without flag i should be kept intact, save it */
-        p = createKeyrange(p, c->minFlags, c->minVal, c->maxFlags & ~mask, c->maxVal, c);
-        if (p == NULL) return -1;
-	/* now handling part with flag i */
-        c->minFlags |= mask;
+      if (!(c.minFlags & mask) &&  (minFlags & mask)) {
+        /* && (c.maxFlags & mask) */
+	/* part without flag j should be kept intact, save it */
+        if (appendKeyrange(&result, c.minFlags, c.minVal, c.maxFlags & ~mask, c.maxVal) == -1) goto error;
+	/* now handling part with flag j */
+        c.minFlags |= mask;
       }
 
-      if ( (c->maxFlags & mask) && !(maxFlags & mask)) {
-        /* && !(c->minFlags & mask) */
-	/* part with flag i should be kept intact, save it */
-        p = createKeyrange(p, c->minFlags | mask, c->minVal, c->maxFlags, c->maxVal, c);
-        if (p == NULL) return -1;
-	/* now handling part without flag i */
-        c->maxFlags &= ~mask;
+      if ( (c.maxFlags & mask) && !(maxFlags & mask)) {
+        /* && !(c.minFlags & mask) */
+	/* part with flag j should be kept intact, save it */
+        if (appendKeyrange(&result, c.minFlags | mask, c.minVal, c.maxFlags, c.maxVal) == -1) goto error;
+	/* now handling part without flag j */
+        c.maxFlags &= ~mask;
       }
 
-      if (!(c->maxFlags | ~minFlags) || !(~c->minFlags | maxFlags))
+      if (!(c.maxFlags | ~minFlags) || !(~c.minFlags | maxFlags))
         /* don't intersect any more*/
 	break;
     }
-    if (i<32) {
+
+    if (j<32) {
       /* don't intersect any more, keep it */
-      break;
-    } else {
-      /* remaining intersection, drop it */
-      tmp = c; c = c->next;
-      freeKeyrange(p,tmp);
+      if (appendKeyrange(&result, c.minFlags, c.minVal, c.maxFlags, c.maxVal) == -1) goto error;
     }
+    /* else remaining intersection, drop it */
   }
 
+  free(list->ranges);
+  free(list->reach);
+  *list = result;
+  indexKeyrangeList(list);
   return 0;
+
+error:
+  free(result.ranges);
+  free(result.reach);
+  return -1;
 }
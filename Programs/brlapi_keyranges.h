@@ -35,29 +35,35 @@ typedef uint64_t KeyrangeElem;
 #define KeyrangeElem(flags,val) (((KeyrangeElem)(flags) << 32) | (val))
 	
 
-typedef struct KeyrangeList {
+typedef struct {
   uint32_t minFlags, maxFlags;
   uint32_t minVal, maxVal;
-  struct KeyrangeList *next;
+} Keyrange;
+
+/* The ranges are kept sorted by minVal, and reach[i] holds the highest */
+/* maxVal of ranges 0..i, so that a lookup is a binary search followed by */
+/* a short backward scan over the ranges which can still contain the value */
+typedef struct KeyrangeList {
+  Keyrange *ranges;
+  uint32_t *reach;
+  unsigned int count;
+  unsigned int size;
 } KeyrangeList;
 
 /* Function : freeKeyrangeList */
 /* Frees a whole list */
-/* If you want to destroy a whole list, call this function, rather than */
-/* calling freeKeyrange on each element, since th latter cares about links */
-/* and hence is slower */
 extern void freeKeyrangeList(KeyrangeList **l);
 
 /* Function : inKeyrangeList */
 /* Determines if the range list l contains x */
-/* If yes, returns the adress of the cell [a..b] such that a<=x<=b */
+/* If yes, returns the adress of the range [a..b] such that a<=x<=b */
 /* If no, returns NULL */
-extern KeyrangeList *inKeyrangeList(KeyrangeList *l, KeyrangeElem n);
+extern const Keyrange *inKeyrangeList(const KeyrangeList *l, KeyrangeElem n);
 
 /* Function : displayKeyrangeList */
 /* Prints a range list on stdout */
 /* This is for debugging only */
-extern void displayKeyrangeList(KeyrangeList *l);
+extern void displayKeyrangeList(const KeyrangeList *l);
 
 /* Function : addKeyrange */
 /* Adds a range to a range list */
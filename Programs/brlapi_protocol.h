@@ -39,6 +39,9 @@ extern "C" {
 /* The type size_t is defined there! */
 #include <unistd.h>
 
+/* this is for offsetof */
+#include <stddef.h>
+
 /** \defgroup brlapi_protocol BrlAPI's protocol
  * \brief Instructions and constants for \e BrlAPI 's protocol
  *
@@ -74,6 +77,7 @@ extern "C" {
 #define BRLAPI_PACKET_EXCEPTION       'E'   /**< Exception                   */
 #define BRLAPI_PACKET_SUSPENDDRIVER   'S'   /**< Suspend driver              */
 #define BRLAPI_PACKET_RESUMEDRIVER    'R'   /**< Resume driver               */
+#define BRLAPI_PACKET_SHAREWINDOW     'W'   /**< Share window memory         */
 
 /** Magic number to give when sending a BRLPACKET_ENTERRAWMODE or BRLPACKET_SUSPEND packet */
 #define BRLAPI_DEVICE_MAGIC (0xdeadbeefL)
@@ -106,7 +110,11 @@ typedef struct {
 #define BRLAPI_AUTH_KEY  'K' /**< Key authorization                         */
 #define BRLAPI_AUTH_CRED 'C' /**< Explicit socket credentials authorization */
 
-/** Structure of error packets */
+/** Structure of error packets
+ *
+ * Exceptions always carry the type and the content of the guilty packet.
+ * Non-fatal errors carry the code, possibly followed by the type of the
+ * request which failed. */
 typedef struct {
   uint32_t code;
   brlapi_packetType_t type;
@@ -135,6 +143,42 @@ typedef struct {
   unsigned char data; /** Fields in the same order as flag weight */
 } brlapi_writeArgumentsPacket_t;
 
+/** Structure of shareWindow packets
+ *
+ * The file descriptors of the shared window memory and of its wakeup
+ * notifier are passed along as SCM_RIGHTS ancillary data, hence this is
+ * only available on local sockets. */
+typedef struct {
+  uint32_t cells;
+} brlapi_shareWindowPacket_t;
+
+/** Magic number at the beginning of a shared window */
+#define BRLAPI_SHAREDWINDOW_MAGIC (0x42574e44L)
+
+/** Layout of the memory shared by a local client for its window
+ *
+ * It holds the latest text and cursor the client wrote with
+ * brlapi_writeText(). The client makes \e sequence odd while it updates
+ * the content, and the server copies the window only once \e sequence
+ * is even and has not changed during the copy. The server stores in
+ * \e consumed the last sequence it has looked at, and the client only
+ * notifies it again when that has caught up. \e writes is the number of
+ * write packets the client had sent on the socket before this update, so
+ * that both ways of writing stay ordered. */
+typedef struct {
+  uint32_t magic;
+  uint32_t cells;
+  volatile uint32_t sequence;
+  volatile uint32_t consumed;
+  uint32_t writes;
+  int32_t cursor;
+  uint32_t text[1];
+} brlapi_sharedWindow_t;
+
+/** Size of the memory shared for a window of the given number of cells */
+#define BRLAPI_SHAREDWINDOW_SIZE(cells) \
+  (offsetof(brlapi_sharedWindow_t, text) + (cells) * sizeof(uint32_t))
+
 /** Type for packets.  Should be used instead of a mere char[], since it has
  * correct alignment requirements. */
 typedef union {
@@ -145,6 +189,7 @@ typedef union {
 	brlapi_errorPacket_t error;
 	brlapi_getDriverSpecificModePacket_t getDriverSpecificMode;
 	brlapi_writeArgumentsPacket_t writeArguments;
+	brlapi_shareWindowPacket_t shareWindow;
 	uint32_t uint32;
 } brlapi_packet_t;
 
@@ -57,6 +57,8 @@
 #else /* HAVE_SYS_SELECT_H */
 #include <sys/time.h>
 #endif /* HAVE_SYS_SELECT_H */
+
+#include <sys/mman.h>
 #endif /* __MINGW32__ */
 
 #define BRLAPI_NO_DEPRECATED
@@ -108,13 +110,16 @@
 typedef enum {
   PARM_AUTH,
   PARM_HOST,
-  PARM_STACKSIZE
+  PARM_STACKSIZE,
+  PARM_BATCHKEYS
 } Parameters;
 
-const char *const api_parameters[] = { "auth", "host", "stacksize", NULL };
+const char *const api_parameters[] = { "auth", "host", "stacksize", "batchkeys", NULL };
 
 static size_t stackSize;
 static AsyncEvent *flushEvent;
+static unsigned int batchKeys; /* send the keys of an input cycle together */
+static AsyncEvent *keyBatchEvent;
 
 #define RELEASE "BrlAPI Server: release " BRLAPI_RELEASE
 #define COPYRIGHT "   Copyright (C) 2002-2016 by Sébastien Hinderer <Sebastien.Hinderer@ens-lyon.org>, \
@@ -123,7 +128,7 @@ Samuel Thibault <samuel.thibault@ens-lyon.org>"
 #define WERR(x, y, ...) do { \
   logMessage(LOG_ERR, "writing error %d to %"PRIfd, y, x); \
   logMessage(LOG_ERR, __VA_ARGS__); \
-  writeError(x, y); \
+  writeRequestError(x, y, type); \
 } while(0)
 #define WEXC(x, y, type, packet, size, ...) do { \
   logMessage(LOG_ERR, "writing exception %d to %"PRIfd, y, x); \
@@ -194,8 +199,36 @@ typedef struct {
 #ifdef __MINGW32__
   OVERLAPPED overl;
 #endif /* __MINGW32__ */
+#ifdef BRLAPI_SHARED_WINDOW
+  int descriptors[BRLAPI_MAXDESCRIPTORS]; /* received along with the packet */
+  unsigned int descriptorCount;
+#endif /* BRLAPI_SHARED_WINDOW */
 } Packet;
 
+/* number of keys which can wait to be sent to a connection together */
+#define KEY_BATCH_SIZE 32
+
+typedef struct {
+  brlapi_header_t header;
+  uint32_t code[2];
+} KeyPacket;
+
+#ifdef HAVE_ICONV_H
+/* number of charset converters kept by each connection */
+#define CHARSET_CONVERTERS 4
+
+typedef struct {
+  char *charset; /* NULL if unused */
+  iconv_t handle; /* from charset to wchar_t */
+} CharsetConverter;
+#endif /* HAVE_ICONV_H */
+
+typedef struct {
+  unsigned long writes; /* number of converted texts */
+  unsigned long microseconds; /* time spent converting them */
+  unsigned long opens; /* number of converters opened */
+} ConversionStatistics;
+
 typedef struct Connection {
   struct Connection *prev, *next;
   FileDescriptor fd;
@@ -210,6 +243,20 @@ typedef struct Connection {
   pthread_mutex_t acceptedKeysMutex;
   time_t upTime;
   Packet packet;
+  uint32_t writes; /* number of write packets received */
+  KeyPacket keyBatch[KEY_BATCH_SIZE]; /* keys waiting to be sent */
+  unsigned int keyBatchCount;
+#ifdef HAVE_ICONV_H
+  CharsetConverter converters[CHARSET_CONVERTERS];
+  unsigned int nextConverter; /* the one to replace when none matches */
+#endif /* HAVE_ICONV_H */
+  ConversionStatistics conversions;
+#ifdef BRLAPI_SHARED_WINDOW
+  brlapi_sharedWindow_t *sharedWindow;
+  unsigned int sharedCells;
+  FileDescriptor sharedWakeup;
+  uint32_t sharedSequence; /* last update applied */
+#endif /* BRLAPI_SHARED_WINDOW */
 } Connection;
 
 typedef struct Tty {
@@ -392,6 +439,17 @@ static void writeError(FileDescriptor fd, unsigned int err)
   brlapiserver_writePacket(fd,BRLAPI_PACKET_ERROR,&code,sizeof(code));
 }
 
+/* Function : writeRequestError */
+/* Sends the given non-fatal error on the given socket, along with the type */
+/* of the request which caused it so that pipelining clients can tell which */
+/* one failed; older clients only look at the code */
+static void writeRequestError(FileDescriptor fd, unsigned int err, brlapi_packetType_t type)
+{
+  uint32_t error[2] = { htonl(err), htonl(type) };
+  logMessage(LOG_CATEGORY(SERVER_EVENTS), "error %u for packet type %lu on fd %"PRIfd, err, (unsigned long)type, fd);
+  brlapiserver_writePacket(fd,BRLAPI_PACKET_ERROR,error,sizeof(error));
+}
+
 /* Function : writeException */
 /* Sends the given error code on the given socket */
 static void writeException(FileDescriptor fd, unsigned int err, brlapi_packetType_t type, const brlapi_packet_t *packet, size_t size)
@@ -408,12 +466,43 @@ static void writeException(FileDescriptor fd, unsigned int err, brlapi_packetTyp
   brlapiserver_writePacket(fd,BRLAPI_PACKET_EXCEPTION,&epacket.data, hdrsize+esize);
 }
 
-static void writeKey(FileDescriptor fd, brlapi_keyCode_t key) {
+/* Function : flushKeyBatch */
+/* Sends the keys waiting for a connection, must be called with */
+/* apiConnectionsMutex locked */
+static void flushKeyBatch(Connection *c) {
+  if (c->keyBatchCount) {
+    logMessage(LOG_CATEGORY(SERVER_EVENTS), "writing %u keys to fd %"PRIfd,c->keyBatchCount,c->fd);
+    if (brlapi_writeFile(c->fd,c->keyBatch,c->keyBatchCount*sizeof(c->keyBatch[0])) < 0)
+      logMessage(LOG_WARNING,"write : %s (connection on fd %"PRIfd")",strerror(errno),c->fd);
+    c->keyBatchCount = 0;
+  }
+}
+
+/* Function : writeKey */
+/* Sends a key to a connection, must be called with apiConnectionsMutex */
+/* locked */
+static void writeKey(Connection *c, brlapi_keyCode_t key) {
   uint32_t buf[2];
   buf[0] = htonl(key >> 32);
   buf[1] = htonl(key & 0xffffffff);
-  logMessage(LOG_CATEGORY(SERVER_EVENTS), "writing key %08"PRIx32" %08"PRIx32" to fd %"PRIfd,buf[0],buf[1],fd);
-  brlapiserver_writePacket(fd,BRLAPI_PACKET_KEY,&buf,sizeof(buf));
+
+  if (batchKeys) {
+    KeyPacket *packet;
+
+    if (c->keyBatchCount == KEY_BATCH_SIZE) flushKeyBatch(c);
+    logMessage(LOG_CATEGORY(SERVER_EVENTS), "batching key %08"PRIx32" %08"PRIx32" for fd %"PRIfd,buf[0],buf[1],c->fd);
+    packet = &c->keyBatch[c->keyBatchCount++];
+    packet->header.size = htonl(sizeof(packet->code));
+    packet->header.type = htonl(BRLAPI_PACKET_KEY);
+    memcpy(packet->code, buf, sizeof(packet->code));
+
+    /* sent once the core is done with the current input */
+    asyncSignalEvent(keyBatchEvent, NULL);
+    return;
+  }
+
+  logMessage(LOG_CATEGORY(SERVER_EVENTS), "writing key %08"PRIx32" %08"PRIx32" to fd %"PRIfd,buf[0],buf[1],c->fd);
+  brlapiserver_writePacket(c->fd,BRLAPI_PACKET_KEY,&buf,sizeof(buf));
 }
 
 /* Function: resetPacket */
@@ -445,10 +534,70 @@ static int initializePacket(Packet *packet)
     return -1;
   }
 #endif /* __MINGW32__ */
+#ifdef BRLAPI_SHARED_WINDOW
+  packet->descriptorCount = 0;
+#endif /* BRLAPI_SHARED_WINDOW */
   resetPacket(packet);
   return 0;
 }
 
+#ifdef BRLAPI_SHARED_WINDOW
+/* Function: closePacketDescriptors */
+/* Closes the file descriptors received along with a packet */
+static void closePacketDescriptors(Packet *packet)
+{
+  while (packet->descriptorCount > 0)
+    close(packet->descriptors[--packet->descriptorCount]);
+}
+
+/* Function: receivePacketData */
+/* Reads the next part of a packet like read() does, keeping the file */
+/* descriptors which come along */
+static ssize_t receivePacketData(Connection *c)
+{
+  Packet *packet = &c->packet;
+  struct iovec iov;
+  union {
+    struct cmsghdr header;
+    char buffer[CMSG_SPACE(BRLAPI_MAXDESCRIPTORS * sizeof(int))];
+  } control;
+  struct msghdr msg;
+  struct cmsghdr *cmsg;
+  ssize_t res;
+
+  iov.iov_base = packet->p;
+  iov.iov_len = packet->n;
+
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buffer;
+  msg.msg_controllen = sizeof(control.buffer);
+
+  if ((res = recvmsg(c->fd, &msg, 0)) == -1) return -1;
+
+  for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if ((cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SCM_RIGHTS)) {
+      const int *descriptors = (const int *) CMSG_DATA(cmsg);
+      unsigned int count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      unsigned int i;
+
+      for (i=0; i<count; i+=1) {
+        if (packet->descriptorCount < ARRAY_COUNT(packet->descriptors)) {
+          packet->descriptors[packet->descriptorCount++] = descriptors[i];
+        } else {
+          close(descriptors[i]);
+        }
+      }
+    }
+  }
+
+  if (msg.msg_flags & MSG_CTRUNC)
+    logMessage(LOG_WARNING, "too many file descriptors received on fd %"PRIfd, c->fd);
+  return res;
+}
+#endif /* BRLAPI_SHARED_WINDOW */
+
 /* Function : readPacket */
 /* Reads a packet for the given connection */
 /* Returns -2 on EOF, -1 on error, 0 if the reading is not complete, */
@@ -472,7 +621,11 @@ read:
 #else /* __MINGW32__ */
   int res;
 read:
+#ifdef BRLAPI_SHARED_WINDOW
+  res = receivePacketData(c);
+#else /* BRLAPI_SHARED_WINDOW */
   res = read(c->fd, packet->p, packet->n);
+#endif /* BRLAPI_SHARED_WINDOW */
   if (res==-1) {
     switch (errno) {
       case EINTR: goto read;
@@ -540,6 +693,7 @@ typedef struct { /* packet handlers */
   PacketHandler packet;
   PacketHandler suspendDriver;
   PacketHandler resumeDriver;
+  PacketHandler shareWindow;
 } PacketHandlers;
 
 /****************************************************************************/
@@ -655,6 +809,22 @@ static Connection *createConnection(FileDescriptor fd, time_t currentTime)
   c->brailleWindow.text = NULL;
   c->brailleWindow.andAttr = NULL;
   c->brailleWindow.orAttr = NULL;
+  c->writes = 0;
+  c->keyBatchCount = 0;
+#ifdef HAVE_ICONV_H
+  {
+    unsigned int i;
+    for (i=0; i<CHARSET_CONVERTERS; i+=1) c->converters[i].charset = NULL;
+  }
+  c->nextConverter = 0;
+#endif /* HAVE_ICONV_H */
+  memset(&c->conversions, 0, sizeof(c->conversions));
+#ifdef BRLAPI_SHARED_WINDOW
+  c->sharedWindow = NULL;
+  c->sharedCells = 0;
+  c->sharedWakeup = INVALID_FILE_DESCRIPTOR;
+  c->sharedSequence = 0;
+#endif /* BRLAPI_SHARED_WINDOW */
   if (initializePacket(&c->packet))
     goto outmalloc;
   return c;
@@ -667,10 +837,48 @@ out:
   return NULL;
 }
 
+#ifdef BRLAPI_SHARED_WINDOW
+/* Function : releaseSharedWindow */
+/* Stops using the window shared by a connection */
+static void releaseSharedWindow(Connection *c)
+{
+  if (c->sharedWindow) {
+    munmap(c->sharedWindow, BRLAPI_SHAREDWINDOW_SIZE(c->sharedCells));
+    c->sharedWindow = NULL;
+    c->sharedCells = 0;
+    closeFileDescriptor(c->sharedWakeup);
+    c->sharedWakeup = INVALID_FILE_DESCRIPTOR;
+  }
+}
+#endif /* BRLAPI_SHARED_WINDOW */
+
+#ifdef HAVE_ICONV_H
+/* Function : closeCharsetConverter */
+static void closeCharsetConverter(CharsetConverter *converter)
+{
+  if (converter->charset) {
+    iconv_close(converter->handle);
+    free(converter->charset);
+    converter->charset = NULL;
+  }
+}
+#endif /* HAVE_ICONV_H */
+
 /* Function : freeConnection */
 /* Frees all resources associated to a connection */
 static void freeConnection(Connection *c)
 {
+  if (c->conversions.writes) {
+    logMessage(LOG_CATEGORY(SERVER_EVENTS), "fd %"PRIfd" converted %lu texts in %lu us, %lu converters opened",
+      c->fd, c->conversions.writes, c->conversions.microseconds, c->conversions.opens);
+  }
+#ifdef HAVE_ICONV_H
+  {
+    unsigned int i;
+    for (i=0; i<CHARSET_CONVERTERS; i+=1) closeCharsetConverter(&c->converters[i]);
+  }
+#endif /* HAVE_ICONV_H */
+
   if (c->fd != INVALID_FILE_DESCRIPTOR) {
     if (c->auth != 1) unauthConnections--;
     closeFileDescriptor(c->fd);
@@ -684,6 +892,10 @@ static void freeConnection(Connection *c)
 
   freeBrailleWindow(&c->brailleWindow);
   freeKeyrangeList(&c->acceptedKeys);
+#ifdef BRLAPI_SHARED_WINDOW
+  releaseSharedWindow(c);
+  closePacketDescriptors(&c->packet);
+#endif /* BRLAPI_SHARED_WINDOW */
   free(c);
 }
 
@@ -935,11 +1147,16 @@ static void doLeaveTty(Connection *c)
   logMessage(LOG_CATEGORY(SERVER_EVENTS), "fd %"PRIfd"releasing tty %#010x",c->fd,tty->number);
   c->tty = NULL;
   lockMutex(&apiConnectionsMutex);
+  /* keys are no longer expected once the ack has been received */
+  flushKeyBatch(c);
   __removeConnection(c);
   __addConnection(c,notty.connections);
   unlockMutex(&apiConnectionsMutex);
   freeKeyrangeList(&c->acceptedKeys);
   freeBrailleWindow(&c->brailleWindow);
+#ifdef BRLAPI_SHARED_WINDOW
+  releaseSharedWindow(c);
+#endif /* BRLAPI_SHARED_WINDOW */
 }
 
 static int handleLeaveTtyMode(Connection *c, brlapi_packetType_t type, brlapi_packet_t *packet, size_t size)
@@ -978,6 +1195,123 @@ static int handleKeyRanges(Connection *c, brlapi_packetType_t type, brlapi_packe
   return 0;
 }
 
+typedef enum {
+  TEXT_CONVERTED,
+  TEXT_UNSUPPORTED_CHARSET,
+  TEXT_INVALID_CHARSET,
+  TEXT_INVALID,
+  TEXT_TOO_BIG,
+  TEXT_TOO_SMALL
+} TextConversion;
+
+typedef enum {
+  TEXT_LATIN1,
+  TEXT_UTF8,
+  TEXT_WCHAR,
+  TEXT_OTHER
+} TextEncoding;
+
+/* Function : getTextEncoding */
+/* Tells whether text in the given charset can be converted without iconv */
+static TextEncoding getTextEncoding(const char *charset)
+{
+  if (!strcasecmp(charset, "UTF-8") || !strcasecmp(charset, "UTF8")) return TEXT_UTF8;
+  if (!strcasecmp(charset, getWcharCharset())) return TEXT_WCHAR;
+  if (!strcasecmp(charset, "ISO-8859-1") || !strcasecmp(charset, "ISO8859-1")) return TEXT_LATIN1;
+  return TEXT_OTHER;
+}
+
+#ifdef HAVE_ICONV_H
+/* Function : getCharsetConverter */
+/* Returns a converter from the given charset to wchar_t, reusing the ones */
+/* the connection opened recently */
+static iconv_t getCharsetConverter(Connection *c, const char *charset)
+{
+  CharsetConverter *converter;
+  iconv_t handle;
+  char *name;
+  unsigned int i;
+
+  for (i=0; i<CHARSET_CONVERTERS; i+=1) {
+    converter = &c->converters[i];
+
+    if (converter->charset && !strcmp(converter->charset, charset)) {
+      /* back to the initial shift state */
+      iconv(converter->handle, NULL, NULL, NULL, NULL);
+      return converter->handle;
+    }
+  }
+
+  if ((handle = iconv_open(getWcharCharset(), charset)) == (iconv_t)(-1)) return handle;
+  c->conversions.opens += 1;
+
+  if (!(name = strdup(charset))) {
+    logMallocError();
+    iconv_close(handle);
+    return (iconv_t)(-1);
+  }
+
+  converter = &c->converters[c->nextConverter];
+  c->nextConverter = (c->nextConverter + 1) % CHARSET_CONVERTERS;
+  closeCharsetConverter(converter);
+  converter->charset = name;
+  converter->handle = handle;
+  return handle;
+}
+#endif /* HAVE_ICONV_H */
+
+/* Function : convertText */
+/* Converts the text of a write request into exactly count characters */
+static TextConversion convertText(Connection *c, const char *charset, const unsigned char *text, size_t size, wchar_t *characters, unsigned int count)
+{
+  switch (charset? getTextEncoding(charset): TEXT_LATIN1) {
+    case TEXT_LATIN1: {
+      unsigned int i;
+      if (size > count) return TEXT_TOO_BIG;
+      if (size < count) return TEXT_TOO_SMALL;
+      for (i=0; i<count; i+=1) characters[i] = text[i];
+      return TEXT_CONVERTED;
+    }
+
+    case TEXT_WCHAR:
+      if (size > count*sizeof(wchar_t)) return TEXT_TOO_BIG;
+      if (size < count*sizeof(wchar_t)) return TEXT_TOO_SMALL;
+      memcpy(characters, text, size);
+      return TEXT_CONVERTED;
+
+    case TEXT_UTF8: {
+      const char *utf8 = (const char *) text;
+      unsigned int i = 0;
+
+      while (size) {
+        wint_t character;
+        if (i == count) return TEXT_TOO_BIG;
+        if ((character = convertUtf8ToWchar(&utf8, &size)) == WEOF) return TEXT_INVALID;
+        characters[i++] = character;
+      }
+
+      if (i < count) return TEXT_TOO_SMALL;
+      return TEXT_CONVERTED;
+    }
+
+    default: {
+#ifdef HAVE_ICONV_H
+      iconv_t handle = getCharsetConverter(c, charset);
+      char *in = (char *) text, *out = (char *) characters;
+      size_t sin = size, sout = count*sizeof(wchar_t);
+
+      if (handle == (iconv_t)(-1)) return TEXT_INVALID_CHARSET;
+      if (iconv(handle,&in,&sin,&out,&sout) == (size_t) -1) return TEXT_INVALID;
+      if (sin) return TEXT_TOO_BIG;
+      if (sout) return TEXT_TOO_SMALL;
+      return TEXT_CONVERTED;
+#else /* HAVE_ICONV_H */
+      return TEXT_UNSUPPORTED_CHARSET;
+#endif /* HAVE_ICONV_H */
+    }
+  }
+}
+
 static int handleWrite(Connection *c, brlapi_packetType_t type, brlapi_packet_t *packet, size_t size)
 {
   brlapi_writeArgumentsPacket_t *wa = &packet->writeArguments;
@@ -988,9 +1322,7 @@ static int handleWrite(Connection *c, brlapi_packetType_t type, brlapi_packet_t
   int remaining = size;
   char *charset = NULL;
   unsigned int charsetLen = 0;
-#ifdef HAVE_ICONV_H
   char *coreCharset = NULL;
-#endif /* HAVE_ICONV_H */
   CHECKEXC(remaining>=sizeof(wa->flags), BRLAPI_ERROR_INVALID_PACKET, "packet too small for flags");
   CHECKERR(!c->raw,BRLAPI_ERROR_ILLEGAL_INSTRUCTION,"not allowed in raw mode");
   CHECKERR(c->tty,BRLAPI_ERROR_ILLEGAL_INSTRUCTION,"not allowed out of tty mode");
@@ -1064,11 +1396,13 @@ static int handleWrite(Connection *c, brlapi_packetType_t type, brlapi_packet_t
   CHECKEXC(remaining==0, BRLAPI_ERROR_INVALID_PACKET, "packet too big");
   /* Here the whole packet has been checked */
   if (text) {
+    wchar_t textBuf[rsiz];
+    TextConversion conversion;
+    TimeValue start, end;
+    long int microseconds;
+
     if (charset) {
       charset[charsetLen] = 0; /* we have room for this */
-#ifndef HAVE_ICONV_H
-      CHECKEXC(!strcasecmp(charset, "iso-8859-1"), BRLAPI_ERROR_OPNOTSUPP, "charset conversion not supported (enable iconv?)");
-#endif /* !HAVE_ICONV_H */
     }
 #ifdef HAVE_ICONV_H
     else {
@@ -1078,31 +1412,27 @@ static int handleWrite(Connection *c, brlapi_packetType_t type, brlapi_packet_t
         unlockCharset();
       }
     }
-    if (charset) {
-      iconv_t conv;
-      wchar_t textBuf[rsiz];
-      char *in = (char *) text, *out = (char *) textBuf;
-      size_t sin = textLen, sout = sizeof(textBuf), res;
-      logMessage(LOG_CATEGORY(SERVER_EVENTS), "fd %"PRIfd" charset %s",c->fd,charset);
-      CHECKEXC((conv = iconv_open(getWcharCharset(),charset)) != (iconv_t)(-1), BRLAPI_ERROR_INVALID_PACKET, "invalid charset");
-      res = iconv(conv,&in,&sin,&out,&sout);
-      iconv_close(conv);
-      CHECKEXC(res != (size_t) -1, BRLAPI_ERROR_INVALID_PACKET, "invalid charset conversion");
-      CHECKEXC(!sin, BRLAPI_ERROR_INVALID_PACKET, "text too big");
-      CHECKEXC(!sout, BRLAPI_ERROR_INVALID_PACKET, "text too small");
-      if (coreCharset) unlockCharset();
-      lockMutex(&c->brailleWindowMutex);
-      memcpy(c->brailleWindow.text+rbeg-1,textBuf,rsiz*sizeof(wchar_t));
-    } else
 #endif /* HAVE_ICONV_H */
-    {
-      int i;
-      lockMutex(&c->brailleWindowMutex);
-      for (i=0; i<rsiz; i++) {
-	/* assume latin1 */
-        c->brailleWindow.text[rbeg-1+i] = text[i];
-      }
-    }
+
+    getMonotonicTime(&start);
+    conversion = convertText(c, charset, text, textLen, textBuf, rsiz);
+    getMonotonicTime(&end);
+    if (coreCharset) unlockCharset();
+
+    CHECKEXC(conversion != TEXT_UNSUPPORTED_CHARSET, BRLAPI_ERROR_OPNOTSUPP, "charset conversion not supported (enable iconv?)");
+    CHECKEXC(conversion != TEXT_INVALID_CHARSET, BRLAPI_ERROR_INVALID_PACKET, "invalid charset");
+    CHECKEXC(conversion != TEXT_INVALID, BRLAPI_ERROR_INVALID_PACKET, "invalid charset conversion");
+    CHECKEXC(conversion != TEXT_TOO_BIG, BRLAPI_ERROR_INVALID_PACKET, "text too big");
+    CHECKEXC(conversion != TEXT_TOO_SMALL, BRLAPI_ERROR_INVALID_PACKET, "text too small");
+
+    microseconds = microsecondsBetween(&start, &end);
+    c->conversions.writes += 1;
+    c->conversions.microseconds += microseconds;
+    logMessage(LOG_CATEGORY(SERVER_EVENTS), "fd %"PRIfd" charset %s: %u cells converted in %ld us",
+      c->fd, charset? charset: "default", rsiz, microseconds);
+
+    lockMutex(&c->brailleWindowMutex);
+    memcpy(c->brailleWindow.text+rbeg-1,textBuf,rsiz*sizeof(wchar_t));
     if (!andAttr) memset(c->brailleWindow.andAttr+rbeg-1,0xFF,rsiz);
     if (!orAttr)  memset(c->brailleWindow.orAttr+rbeg-1,0x00,rsiz);
   } else lockMutex(&c->brailleWindowMutex);
@@ -1115,7 +1445,149 @@ static int handleWrite(Connection *c, brlapi_packetType_t type, brlapi_packet_t
   return 0;
 }
 
-static int checkDriverSpecificModePacket(Connection *c, brlapi_packet_t *packet, size_t size)
+#ifdef BRLAPI_SHARED_WINDOW
+/* Function : applySharedWindow */
+/* Copies the latest update of the window shared by a connection */
+static void applySharedWindow(Connection *c)
+{
+  brlapi_sharedWindow_t *window = c->sharedWindow;
+  unsigned int cells = c->sharedCells;
+
+  /* The client publishes updates without waiting for us, so check again */
+  /* after saying what has been seen: if it published meanwhile, it may */
+  /* have decided not to notify us. */
+  while (1) {
+    uint32_t sequence = window->sequence;
+    uint32_t seen = sequence;
+    brlapi_memoryBarrier();
+
+    if (sequence & 1) {
+      /* being updated, the client notifies us when it's done */
+      seen = sequence - 1;
+    } else if ((sequence != c->sharedSequence) && !c->raw && c->tty) {
+      int32_t ahead = window->writes - c->writes;
+
+      if (ahead < 0) {
+        /* a later write packet has already replaced it */
+        c->sharedSequence = sequence;
+      } else if (ahead == 0) {
+        wchar_t text[cells];
+        int32_t cursor = window->cursor;
+        unsigned int i;
+
+        for (i=0; i<cells; i+=1) text[i] = window->text[i];
+        brlapi_memoryBarrier();
+        if (window->sequence != sequence) continue;
+
+        if ((cells == displaySize) && c->brailleWindow.text) {
+          lockMutex(&c->brailleWindowMutex);
+          memcpy(c->brailleWindow.text, text, cells*sizeof(wchar_t));
+          memset(c->brailleWindow.andAttr, 0XFF, cells);
+          memset(c->brailleWindow.orAttr, 0X00, cells);
+          if ((cursor >= 0) && (cursor <= cells)) c->brailleWindow.cursor = cursor;
+          c->brlbufstate = TODISPLAY;
+          unlockMutex(&c->brailleWindowMutex);
+          asyncSignalEvent(flushEvent, NULL);
+        }
+
+        c->sharedSequence = sequence;
+      }
+      /* else it follows write packets not received yet */
+    }
+
+    window->consumed = seen;
+    brlapi_memoryBarrier();
+    if (window->sequence == sequence) break;
+  }
+}
+
+/* Function : handleSharedWindowWakeup */
+/* Handles a notification of an update of a shared window */
+static void handleSharedWindowWakeup(Connection *c)
+{
+  char buffer[0X40];
+
+  /* one read resets an eventfd, and anything left in a pipe wakes us again */
+  if (read(c->sharedWakeup, buffer, sizeof(buffer)) == -1) {
+    if (errno != EAGAIN) logSystemError("read[shared window wakeup]");
+  }
+
+  applySharedWindow(c);
+}
+
+/* Function : isSharedWindowWakeup */
+/* Tells whether a descriptor can be used to be woken for shared updates */
+static int isSharedWindowWakeup(int descriptor)
+{
+  struct stat status;
+
+  if (fstat(descriptor, &status) == -1) return 0;
+  if (S_ISFIFO(status.st_mode)) return 1;
+
+#ifdef __linux__
+  /* an eventfd is an anonymous inode, which has no file type */
+  if (!(status.st_mode & S_IFMT)) {
+    char path[0X40];
+    char target[0X40];
+    ssize_t length;
+
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", descriptor);
+
+    if ((length = readlink(path, target, sizeof(target)-1)) != -1) {
+      target[length] = 0;
+      return strcmp(target, "anon_inode:[eventfd]") == 0;
+    }
+  }
+#endif /* __linux__ */
+
+  return 0;
+}
+
+static int handleShareWindow(Connection *c, brlapi_packetType_t type, brlapi_packet_t *packet, size_t size)
+{
+  brlapi_shareWindowPacket_t *sw = &packet->shareWindow;
+  int *descriptors = c->packet.descriptors;
+  brlapi_sharedWindow_t *window;
+  unsigned int cells;
+  struct stat status;
+  int seals;
+
+  CHECKEXC(size==sizeof(*sw), BRLAPI_ERROR_INVALID_PACKET, "wrong packet size");
+  CHECKERR(!c->raw,BRLAPI_ERROR_ILLEGAL_INSTRUCTION,"not allowed in raw mode");
+  CHECKERR(c->tty,BRLAPI_ERROR_ILLEGAL_INSTRUCTION,"not allowed out of tty mode");
+  CHECKERR(!c->sharedWindow,BRLAPI_ERROR_ILLEGAL_INSTRUCTION,"window already shared");
+  CHECKERR(c->packet.descriptorCount==2, BRLAPI_ERROR_INVALID_PARAMETER, "shared window descriptors missing");
+  cells = ntohl(sw->cells);
+  CHECKERR(cells==displaySize, BRLAPI_ERROR_INVALID_PARAMETER, "wrong shared window size");
+  CHECKERR(fstat(descriptors[0], &status) != -1, BRLAPI_ERROR_INVALID_PARAMETER, "invalid shared window memory");
+  CHECKERR(status.st_size >= BRLAPI_SHAREDWINDOW_SIZE(cells), BRLAPI_ERROR_INVALID_PARAMETER, "shared window memory too small");
+  /* the client must not be able to make us get SIGBUS */
+  seals = fcntl(descriptors[0], F_GET_SEALS);
+  CHECKERR((seals != -1) && (seals & F_SEAL_SHRINK), BRLAPI_ERROR_INVALID_PARAMETER, "shared window memory can be shrunk");
+  CHECKERR(isSharedWindowWakeup(descriptors[1]), BRLAPI_ERROR_INVALID_PARAMETER, "invalid shared window wakeup");
+
+  window = mmap(NULL, BRLAPI_SHAREDWINDOW_SIZE(cells), PROT_READ | PROT_WRITE, MAP_SHARED, descriptors[0], 0);
+  CHECKERR(window != MAP_FAILED, BRLAPI_ERROR_NOMEM, "cannot map shared window");
+  if ((window->magic != BRLAPI_SHAREDWINDOW_MAGIC) || (window->cells != cells)) {
+    munmap(window, BRLAPI_SHAREDWINDOW_SIZE(cells));
+    WERR(c->fd, BRLAPI_ERROR_INVALID_PARAMETER, "invalid shared window");
+    return 0;
+  }
+  setBlockingIo(descriptors[1], 0);
+
+  c->sharedWindow = window;
+  c->sharedCells = cells;
+  c->sharedWakeup = descriptors[1];
+  c->sharedSequence = 0;
+  close(descriptors[0]);
+  c->packet.descriptorCount = 0;
+  logMessage(LOG_CATEGORY(SERVER_EVENTS), "fd %"PRIfd" shares its window",c->fd);
+  writeAck(c->fd);
+  return 0;
+}
+#endif /* BRLAPI_SHARED_WINDOW */
+
+static int checkDriverSpecificModePacket(Connection *c, brlapi_packetType_t type, brlapi_packet_t *packet, size_t size)
 {
   brlapi_getDriverSpecificModePacket_t *getDevicePacket = &packet->getDriverSpecificMode;
   int remaining = size;
@@ -1132,7 +1604,7 @@ static int checkDriverSpecificModePacket(Connection *c, brlapi_packet_t *packet,
 static int handleEnterRawMode(Connection *c, brlapi_packetType_t type, brlapi_packet_t *packet, size_t size)
 {
   CHECKERR(!c->raw, BRLAPI_ERROR_ILLEGAL_INSTRUCTION,"not allowed in raw mode");
-  if (!checkDriverSpecificModePacket(c, packet, size)) return 0;
+  if (!checkDriverSpecificModePacket(c, type, packet, size)) return 0;
   CHECKERR(isRawCapable(trueBraille), BRLAPI_ERROR_OPNOTSUPP, "driver doesn't support Raw mode");
   lockMutex(&apiRawMutex);
   if (rawConnection || suspendConnection) {
@@ -1178,7 +1650,7 @@ static int handlePacket(Connection *c, brlapi_packetType_t type, brlapi_packet_t
 
 static int handleSuspendDriver(Connection *c, brlapi_packetType_t type, brlapi_packet_t *packet, size_t size)
 {
-  if (!checkDriverSpecificModePacket(c, packet, size)) return 0;
+  if (!checkDriverSpecificModePacket(c, type, packet, size)) return 0;
   CHECKERR(!c->suspend,BRLAPI_ERROR_ILLEGAL_INSTRUCTION, "not allowed in suspend mode");
   lockMutex(&apiRawMutex);
   if (suspendConnection || rawConnection) {
@@ -1214,7 +1686,12 @@ static PacketHandlers packetHandlers = {
   handleGetDriverName, handleGetDisplaySize,
   handleEnterTtyMode, handleSetFocus, handleLeaveTtyMode,
   handleKeyRanges, handleKeyRanges, handleWrite,
-  handleEnterRawMode, handleLeaveRawMode, handlePacket, handleSuspendDriver, handleResumeDriver
+  handleEnterRawMode, handleLeaveRawMode, handlePacket, handleSuspendDriver, handleResumeDriver,
+#ifdef BRLAPI_SHARED_WINDOW
+  handleShareWindow,
+#else /* BRLAPI_SHARED_WINDOW */
+  NULL,
+#endif /* BRLAPI_SHARED_WINDOW */
 };
 
 static void handleNewConnection(Connection *c)
@@ -1395,11 +1872,26 @@ static int processRequest(Connection *c, PacketHandlers *handlers)
     case BRLAPI_PACKET_PACKET: p = handlers->packet; break;
     case BRLAPI_PACKET_SUSPENDDRIVER: p = handlers->suspendDriver; break;
     case BRLAPI_PACKET_RESUMEDRIVER: p = handlers->resumeDriver; break;
+    case BRLAPI_PACKET_SHAREWINDOW: p = handlers->shareWindow; break;
   }
   if (p!=NULL) {
     logRequest(type, c->fd);
+#ifdef BRLAPI_SHARED_WINDOW
+    /* shared updates and write packets must be applied in the order the */
+    /* client made them */
+    if ((type == BRLAPI_PACKET_WRITE) && c->sharedWindow) applySharedWindow(c);
+#endif /* BRLAPI_SHARED_WINDOW */
     p(c, type, packet, size);
+    if (type == BRLAPI_PACKET_WRITE) {
+      c->writes++;
+#ifdef BRLAPI_SHARED_WINDOW
+      if (c->sharedWindow) applySharedWindow(c);
+#endif /* BRLAPI_SHARED_WINDOW */
+    }
   } else WEXC(c->fd,BRLAPI_ERROR_UNKNOWN_INSTRUCTION, type, packet, size, "unknown packet type");
+#ifdef BRLAPI_SHARED_WINDOW
+  closePacketDescriptors(&c->packet);
+#endif /* BRLAPI_SHARED_WINDOW */
   return 0;
 }
 
@@ -2047,6 +2539,12 @@ static void addTtyFds(fd_set *fds, int *fdmax, Tty *tty) {
 #else /* __MINGW32__ */
       if (c->fd>*fdmax) *fdmax = c->fd;
       FD_SET(c->fd,fds);
+#ifdef BRLAPI_SHARED_WINDOW
+      if (c->sharedWindow) {
+        if (c->sharedWakeup>*fdmax) *fdmax = c->sharedWakeup;
+        FD_SET(c->sharedWakeup,fds);
+      }
+#endif /* BRLAPI_SHARED_WINDOW */
 #endif /* __MINGW32__ */
     }
   }
@@ -2070,6 +2568,12 @@ static void handleTtyFds(fd_set *fds, time_t currentTime, Tty *tty) {
     while (c!=tty->connections) {
       int remove = 0;
       next = c->next;
+#ifdef BRLAPI_SHARED_WINDOW
+      if (c->sharedWindow && FD_ISSET(c->sharedWakeup, fds)) {
+        FD_CLR(c->sharedWakeup, fds);
+        handleSharedWindowWakeup(c);
+      }
+#endif /* BRLAPI_SHARED_WINDOW */
 #ifdef __MINGW32__
       if (WaitForSingleObject(c->packet.overl.hEvent,0) == WAIT_OBJECT_0)
 #else /* __MINGW32__ */
@@ -2576,6 +3080,11 @@ static void ttyTerminationHandler(Tty *tty)
     asyncDiscardEvent(flushEvent);
     flushEvent = NULL;
   }
+
+  if (keyBatchEvent) {
+    asyncDiscardEvent(keyBatchEvent);
+    keyBatchEvent = NULL;
+  }
 }
 /* Function : terminationHandler */
 /* Terminates driver */
@@ -2689,7 +3198,7 @@ static void broadcastKey(Tty *tty, brlapi_keyCode_t code, unsigned int how) {
   for (c=tty->connections->next; c!=tty->connections; c = c->next) {
     lockMutex(&c->acceptedKeysMutex);
     if ((c->how==how) && (inKeyrangeList(c->acceptedKeys,code) != NULL))
-      writeKey(c->fd,code);
+      writeKey(c,code);
     unlockMutex(&c->acceptedKeysMutex);
   }
   for (t = tty->subttys; t; t = t->next)
@@ -2707,7 +3216,7 @@ static int api__handleKeyEvent(brlapi_keyCode_t clientCode) {
   /* somebody gets the raw code */
   if ((c = whoGetsKey(&ttys,clientCode,BRL_KEYCODES))) {
     logMessage(LOG_CATEGORY(SERVER_EVENTS), "transmitting accepted key %016"BRLAPI_PRIxKEYCODE" to fd %"PRIfd,clientCode,c->fd);
-    writeKey(c->fd,clientCode);
+    writeKey(c,clientCode);
     return 1;
   }
   return 0;
@@ -2767,7 +3276,7 @@ static int api__handleCommand(int command) {
 
     if (c) {
       logMessage(LOG_CATEGORY(SERVER_EVENTS), "transmitting accepted command %lx as client code %016"BRLAPI_PRIxKEYCODE" to fd %"PRIfd,(unsigned long)command,code,c->fd);
-      writeKey(c->fd, code);
+      writeKey(c, code);
       return 1;
     }
   }
@@ -2907,6 +3416,24 @@ out:
   return ok;
 }
 
+/* Function : flushKeyBatches */
+/* Recursively sends the keys waiting for the connections of ttys */
+static void flushKeyBatches(Tty *tty) {
+  Connection *c;
+  Tty *t;
+  for (c=tty->connections->next; c!=tty->connections; c = c->next)
+    flushKeyBatch(c);
+  for (t = tty->subttys; t; t = t->next)
+    flushKeyBatches(t);
+}
+
+ASYNC_EVENT_CALLBACK(handleKeyBatchEvent) {
+  lockMutex(&apiConnectionsMutex);
+  flushKeyBatches(&notty);
+  flushKeyBatches(&ttys);
+  unlockMutex(&apiConnectionsMutex);
+}
+
 ASYNC_EVENT_CALLBACK(handleServerFlushEvent) {
   BrailleDisplay *brl = parameters->eventData;
   api_flush(brl);
@@ -3064,6 +3591,17 @@ int api_start(BrailleDisplay *brl, char **parameters)
     }
   }
 
+  batchKeys = 0;
+  {
+    const char *operand = parameters[PARM_BATCHKEYS];
+
+    if (*operand) {
+      if (!validateYesNo(&batchKeys, operand)) {
+        logMessage(LOG_WARNING, "%s: %s", gettext("invalid key batching setting"), operand);
+      }
+    }
+  }
+
   auth = BRLAPI_DEFAUTH;
   {
     const char *operand = parameters[PARM_AUTH];
@@ -3104,6 +3642,7 @@ int api_start(BrailleDisplay *brl, char **parameters)
   pthread_attr_setstacksize(&attr,stackSize);
 
   if (!(flushEvent = asyncNewEvent(handleServerFlushEvent, brl))) goto noFlushEvent;
+  if (!(keyBatchEvent = asyncNewEvent(handleKeyBatchEvent, NULL))) goto noKeyBatchEvent;
 
 #ifndef __MINGW32__
   initializeBlockedSignalsMask();
@@ -3133,6 +3672,8 @@ int api_start(BrailleDisplay *brl, char **parameters)
   return 1;
   
 noServerThread:
+  asyncDiscardEvent(keyBatchEvent);
+noKeyBatchEvent:
   asyncDiscardEvent(flushEvent);
 noFlushEvent:
   freeConnection(ttys.connections);
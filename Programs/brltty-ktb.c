@@ -20,6 +20,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
 
 #include "program.h"
 #include "options.h"
@@ -27,6 +28,9 @@
 #include "file.h"
 #include "parse.h"
 #include "dynld.h"
+#include "timing.h"
+#include "async_wait.h"
+#include "cmd_queue.h"
 #include "ktb.h"
 #include "ktb_keyboard.h"
 #include "brl.h"
@@ -35,6 +39,8 @@ static int opt_audit;
 static int opt_listKeyNames;
 static int opt_listHelpScreen;
 static int opt_listRestructuredText;
+static char *opt_keyEventsFile;
+static char *opt_replayCount;
 static char *opt_tablesDirectory;
 static char *opt_driversDirectory;
 
@@ -67,6 +73,21 @@ BEGIN_OPTION_TABLE(programOptions)
     .description = strtext("List key table in reStructuredText format.")
   },
 
+  { .letter = 'e',
+    .word = "events",
+    .argument = strtext("file"),
+    .setting.string = &opt_keyEventsFile,
+    .description = strtext("Replay the key events logged in a file, and report how long the key table takes to process them.")
+  },
+
+  { .letter = 'p',
+    .word = "passes",
+    .argument = strtext("count"),
+    .setting.string = &opt_replayCount,
+    .internal.setting = "1000",
+    .description = strtext("The number of times to replay the key events.")
+  },
+
   { .letter = 'T',
     .word = "tables-directory",
     .flags = OPT_Hidden,
@@ -320,6 +341,170 @@ static const KeyTableListMethods rstMethods = {
   .endList = rstEndList
 };
 
+typedef struct {
+  KeyGroup group;
+  KeyNumber number;
+  unsigned char press;
+} RecordedKeyEvent;
+
+typedef struct {
+  RecordedKeyEvent *array;
+  unsigned int size;
+  unsigned int count;
+} RecordedKeyEvents;
+
+static int
+addRecordedKeyEvent (char *line, void *data) {
+  /* Key events are logged (see logKeyEvent) as:
+   * [label ]key press|release: name (Ctx:c Grp:g Num:n)[ -> command]
+   */
+  RecordedKeyEvents *events = data;
+  const char *action;
+  unsigned int group;
+  unsigned int number;
+  int press;
+
+  if ((action = strstr(line, "key press: "))) {
+    press = 1;
+  } else if ((action = strstr(line, "key release: "))) {
+    press = 0;
+  } else {
+    return 1;
+  }
+
+  {
+    const char *values = strstr(action, " Grp:");
+
+    if (!values) return 1;
+    if (sscanf(values, " Grp:%u Num:%u", &group, &number) != 2) return 1;
+  }
+
+  if (events->count == events->size) {
+    unsigned int newSize = events->size? events->size<<1: 0X100;
+    RecordedKeyEvent *newArray = realloc(events->array, ARRAY_SIZE(newArray, newSize));
+
+    if (!newArray) {
+      logMallocError();
+      return 0;
+    }
+
+    events->array = newArray;
+    events->size = newSize;
+  }
+
+  {
+    RecordedKeyEvent *event = &events->array[events->count++];
+
+    event->group = group;
+    event->number = number;
+    event->press = press;
+  }
+
+  return 1;
+}
+
+static int
+handleReplayedCommand (int command, void *data) {
+  unsigned int *count = data;
+
+  *count += 1;
+  return 1;
+}
+
+static void
+drainReplayedCommands (const unsigned int *count) {
+  unsigned int previous;
+
+  resumeCommandQueue();
+
+  do {
+    previous = *count;
+    asyncWait(0);
+  } while (*count != previous);
+
+  suspendCommandQueue();
+}
+
+static int
+replayKeyEvents (KeyTable *keyTable) {
+  static const int minimum = 1;
+  int passes;
+  int ok = 0;
+
+  RecordedKeyEvents events = {
+    .array = NULL,
+    .size = 0,
+    .count = 0
+  };
+
+  if (!validateInteger(&passes, opt_replayCount, &minimum, NULL)) {
+    logMessage(LOG_ERR, "invalid pass count: %s", opt_replayCount);
+    return 0;
+  }
+
+  {
+    FILE *stream = fopen(opt_keyEventsFile, "r");
+
+    if (!stream) {
+      logMessage(LOG_ERR, "cannot open file: %s: %s", opt_keyEventsFile, strerror(errno));
+      return 0;
+    }
+
+    ok = processLines(stream, addRecordedKeyEvent, &events);
+    fclose(stream);
+  }
+
+  if (ok) {
+    if (events.count) {
+      unsigned int commands = 0;
+      long int elapsed = 0;
+
+      /* Commands are only dispatched between passes so that the time is
+       * spent within processKeyEvent.
+       */
+      beginCommandQueue();
+      pushCommandHandler("replay", KTB_CTX_DEFAULT, handleReplayedCommand, NULL, &commands);
+      suspendCommandQueue();
+
+      for (int pass=0; pass<passes; pass+=1) {
+        TimeValue start;
+        TimeValue end;
+
+        getMonotonicTime(&start);
+
+        for (unsigned int index=0; index<events.count; index+=1) {
+          const RecordedKeyEvent *event = &events.array[index];
+
+          processKeyEvent(keyTable, KTB_CTX_DEFAULT, event->group, event->number, event->press);
+        }
+
+        getMonotonicTime(&end);
+        elapsed += microsecondsBetween(&start, &end);
+        drainReplayedCommands(&commands);
+      }
+
+      resumeCommandQueue();
+      endCommandQueue();
+
+      {
+        unsigned long int total = (unsigned long int)events.count * passes;
+
+        printf("%u key events x %d passes: %.3fus per event, %lu events/s, %u commands\n",
+               events.count, passes,
+               (double)elapsed / total,
+               (unsigned long int)(((double)total * USECS_PER_SEC) / (elapsed? elapsed: 1)),
+               commands);
+      }
+    } else {
+      logMessage(LOG_ERR, "no key events: %s", opt_keyEventsFile);
+      ok = 0;
+    }
+  }
+
+  if (events.array) free(events.array);
+  return ok;
+}
+
 int
 main (int argc, char *argv[]) {
   ProgramExitStatus exitStatus = PROG_EXIT_SUCCESS;
@@ -388,6 +573,12 @@ main (int argc, char *argv[]) {
             }
           }
 
+          if (*opt_keyEventsFile) {
+            if (!replayKeyEvents(keyTable)) {
+              exitStatus = PROG_EXIT_FATAL;
+            }
+          }
+
           destroyKeyTable(keyTable);
         } else {
           exitStatus = PROG_EXIT_FATAL;
@@ -29,6 +29,8 @@
 #include "scr_special.h"
 #include "message.h"
 #include "alert.h"
+#include "async_alarm.h"
+#include "update.h"
 #include "core.h"
 
 #ifdef ENABLE_SPEECH_SUPPORT
@@ -233,6 +235,12 @@ handleMiscellaneousCommands (int command, void *data) {
       break;
     }
 
+    case BRL_CMD_UPDATE_STATS:
+      logUpdateStatistics();
+      asyncLogAlarms();
+      message(NULL, gettext("update statistics logged"), 0);
+      break;
+
     case BRL_CMD_TIME: {
       TimeFormattingData fmt;
       getTimeFormattingData(&fmt);
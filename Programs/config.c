@@ -44,6 +44,7 @@
 #include "blink.h"
 #include "variables.h"
 #include "datafile.h"
+#include "file_watch.h"
 #include "ttb.h"
 #include "atb.h"
 #include "ctb.h"
@@ -60,6 +61,7 @@
 #include "parse.h"
 #include "dynld.h"
 #include "async_alarm.h"
+#include "async_io.h"
 #include "program.h"
 #include "revision.h"
 #include "service.h"
@@ -155,6 +157,7 @@ static char *opt_logFile;
 static int opt_bootParameters = 1;
 static int opt_environmentVariables;
 static char *opt_messageHoldTimeout;
+static char *opt_ioCallbackLimit;
 
 static int opt_cancelExecution;
 static const char *const optionStrings_CancelExecution[] = {
@@ -186,6 +189,7 @@ static char *oldPreferencesFile = NULL;
 static int oldPreferencesEnabled = 1;
 
 char *opt_tablesDirectory;
+static int opt_watchTables;
 char *opt_textTable;
 char *opt_attributesTable;
 
@@ -418,6 +422,13 @@ BEGIN_OPTION_TABLE(programOptions)
     .description = strtext("Path to directory containing tables.")
   },
 
+  { .letter = 'w',
+    .word = "watch-tables",
+    .flags = OPT_Hidden | OPT_Config | OPT_Environ,
+    .setting.flag = &opt_watchTables,
+    .description = strtext("Reload the text, attributes, and contraction tables when they're edited.")
+  },
+
   { .letter = 't',
     .word = "text-table",
     .bootParameter = 3,
@@ -546,6 +557,14 @@ BEGIN_OPTION_TABLE(programOptions)
     .description = strtext("Message hold timeout (in 10ms units).")
   },
 
+  { .letter = 'Y',
+    .word = "io-callback-limit",
+    .flags = OPT_Hidden,
+    .argument = strtext("count"),
+    .setting.string = &opt_ioCallbackLimit,
+    .description = strtext("Maximum number of input/output callbacks per wait (0 for no limit).")
+  },
+
   { .letter = 'e',
     .word = "standard-error",
     .flags = OPT_Hidden,
@@ -733,9 +752,105 @@ brlttyPrepare (int argc, char *argv[]) {
   return PROG_EXIT_SUCCESS;
 }
 
+typedef int TableLoader (const char *name);
+
+typedef struct {
+  const char *label;
+  TableLoader *loadTable;
+
+  FileWatchObject *watch;
+  char *name;
+} TableWatch;
+
+static void
+stopTableWatch (TableWatch *tw) {
+  if (tw->watch) {
+    destroyFileWatchObject(tw->watch);
+    tw->watch = NULL;
+  }
+
+  if (tw->name) {
+    free(tw->name);
+    tw->name = NULL;
+  }
+}
+
+static
+DATA_FILE_OPENED_HANDLER(addTableWatchPath) {
+  FileWatchObject *watch = data;
+
+  addFileWatchPath(watch, path);
+}
+
+static FileWatchCallback handleTableChanged;
+
+static int
+changeTable (TableWatch *tw, const char *name) {
+  FileWatchObject *watch = NULL;
+  int changed;
+
+  if (opt_watchTables && name && *name) {
+    if ((watch = newFileWatchObject(handleTableChanged, tw))) {
+      setDataFileOpenedHandler(addTableWatchPath, watch);
+    }
+  }
+
+  changed = tw->loadTable(name);
+  setDataFileOpenedHandler(NULL, NULL);
+
+  if (changed) {
+    resetRenderCache();
+    stopTableWatch(tw);
+
+    if (watch) {
+      if ((tw->name = strdup(name))) {
+        tw->watch = watch;
+        watch = NULL;
+      } else {
+        logMallocError();
+      }
+    }
+  }
+
+  if (watch) destroyFileWatchObject(watch);
+  return changed;
+}
+
+static
+FILE_WATCH_CALLBACK(handleTableChanged) {
+  TableWatch *tw = data;
+  char *name = strdup(tw->name);
+
+  if (name) {
+    logMessage(LOG_INFO, "reloading %s table: %s", tw->label, name);
+
+    /* This runs from the main loop, between updates, so the new table is
+     * swapped in at a point where the old one isn't being used. If the edit
+     * has broken the table then the old one, and its watch, are kept.
+     */
+    if (changeTable(tw, name)) {
+      scheduleUpdate("table reloaded");
+    }
+
+    free(name);
+  } else {
+    logMallocError();
+  }
+}
+
+static int
+loadTextTable (const char *name) {
+  return replaceTextTable(opt_tablesDirectory, name);
+}
+
+static TableWatch textTableWatch = {
+  .label = "text",
+  .loadTable = loadTextTable
+};
+
 int
 changeTextTable (const char *name) {
-  return replaceTextTable(opt_tablesDirectory, name);
+  return changeTable(&textTableWatch, name);
 }
 
 static void
@@ -743,9 +858,19 @@ exitTextTable (void *data) {
   changeTextTable(NULL);
 }
 
+static int
+loadAttributesTable (const char *name) {
+  return replaceAttributesTable(opt_tablesDirectory, name);
+}
+
+static TableWatch attributesTableWatch = {
+  .label = "attributes",
+  .loadTable = loadAttributesTable
+};
+
 int
 changeAttributesTable (const char *name) {
-  return replaceAttributesTable(opt_tablesDirectory, name);
+  return changeTable(&attributesTableWatch, name);
 }
 
 static void
@@ -754,16 +879,8 @@ exitAttributesTable (void *data) {
 }
 
 #ifdef ENABLE_CONTRACTED_BRAILLE
-static void
-exitContractionTable (void *data) {
-  if (contractionTable) {
-    destroyContractionTable(contractionTable);
-    contractionTable = NULL;
-  }
-}
-
-int
-changeContractionTable (const char *name) {
+static int
+loadContractionTable (const char *name) {
   ContractionTable *table = NULL;
 
   if (*name) {
@@ -786,6 +903,26 @@ changeContractionTable (const char *name) {
   contractionTable = table;
   return 1;
 }
+
+static TableWatch contractionTableWatch = {
+  .label = "contraction",
+  .loadTable = loadContractionTable
+};
+
+static void
+exitContractionTable (void *data) {
+  stopTableWatch(&contractionTableWatch);
+
+  if (contractionTable) {
+    destroyContractionTable(contractionTable);
+    contractionTable = NULL;
+  }
+}
+
+int
+changeContractionTable (const char *name) {
+  return changeTable(&contractionTableWatch, name);
+}
 #endif /* ENABLE_CONTRACTED_BRAILLE */
 
 static KeyTableState
@@ -954,29 +1091,27 @@ makeBrailleKeyTablePath (void) {
   return makeInputTablePath(opt_tablesDirectory, braille->definition.code, brl.keyBindings);
 }
 
-static void
-makeBrailleHelpPage (const char *keyTablePath) {
+static int
+generateBrailleHelpPage (void *data UNUSED) {
   if (!brl.keyTable) {
-    char *keyHelpPath = replaceFileExtension(keyTablePath, KEY_HELP_EXTENSION);
+    char *keyTablePath = makeBrailleKeyTablePath();
 
-    if (keyHelpPath) {
-      int loaded = 0;
+    if (keyTablePath) {
+      char *keyHelpPath = replaceFileExtension(keyTablePath, KEY_HELP_EXTENSION);
 
-      if (enableBrailleHelpPage()) {
+      if (keyHelpPath) {
         if (loadHelpFile(keyHelpPath)) {
-          loaded = 1;
+          logMessage(LOG_INFO, "%s: %s", gettext("Key Help"), keyHelpPath);
+        } else {
+          logMessage(LOG_WARNING, "%s: %s", gettext("cannot open key help"), keyHelpPath);
         }
-      }
 
-      if (loaded) {
-        logMessage(LOG_INFO, "%s: %s", gettext("Key Help"), keyHelpPath);
-      } else {
-        logMessage(LOG_WARNING, "%s: %s", gettext("cannot open key help"), keyHelpPath);
+        free(keyHelpPath);
       }
 
-      free(keyHelpPath);
+      free(keyTablePath);
     }
-  } else if (enableBrailleHelpPage()) {
+  } else {
     listKeyTable(brl.keyTable, NULL, handleWcharHelpLine, NULL);
   }
 
@@ -984,12 +1119,27 @@ makeBrailleHelpPage (const char *keyTablePath) {
     addHelpLine(WS_C("help not available"));
     message(NULL, gettext("no key bindings"), 0);
   }
+
+  return 1;
+}
+
+static void
+makeBrailleHelpPage (void) {
+  if (enableBrailleHelpPage()) {
+    setHelpPageGenerator(generateBrailleHelpPage, NULL);
+  }
+}
+
+static int
+generateKeyboardHelpPage (void *data UNUSED) {
+  if (!keyboardTable) return 0;
+  return listKeyTable(keyboardTable, NULL, handleWcharHelpLine, NULL);
 }
 
 static void
 makeKeyboardHelpPage (void) {
   if (enableKeyboardHelpPage()) {
-    listKeyTable(keyboardTable, NULL, handleWcharHelpLine, NULL);
+    setHelpPageGenerator(generateKeyboardHelpPage, NULL);
   }
 }
 
@@ -1365,7 +1515,7 @@ constructBrailleDriver (void) {
             }
           }
 
-          makeBrailleHelpPage(keyTablePath);
+          makeBrailleHelpPage();
           free(keyTablePath);
         }
       }
@@ -1463,6 +1613,35 @@ initializeBrailleDriver (const char *code, int verify) {
   return 0;
 }
 
+static int
+selectIndexedDrivers (const char **selected, const char *const *drivers, const char *const *codes) {
+  /* The device index names every driver which can handle a device, but only
+   * those which would have been autodetected anyway are tried, and in their
+   * usual order, so that indexing doesn't change which driver is chosen.
+   */
+  unsigned int count = 0;
+
+  if (codes) {
+    while (*drivers) {
+      const char *const *code = codes;
+
+      while (*code) {
+        if (strcmp(*code, *drivers) == 0) {
+          selected[count++] = *drivers;
+          break;
+        }
+
+        code += 1;
+      }
+
+      drivers += 1;
+    }
+  }
+
+  selected[count] = NULL;
+  return count > 0;
+}
+
 static int
 activateBrailleDriver (int verify) {
   int oneDevice = brailleDevices[0] && !brailleDevices[1];
@@ -1490,7 +1669,18 @@ activateBrailleDriver (int verify) {
           "al", "bm", "eu", "fs", "hd", "hm", "ht", "hw", "mt", "pg", "pm", "sk", "vo",
           NULL
         };
+        static const char *indexedDrivers[ARRAY_COUNT(usbDrivers)];
+        const char **codes = usbGetDriverCodes(dev);
+
         autodetectableDrivers = usbDrivers;
+
+        if (codes) {
+          if (selectIndexedDrivers(indexedDrivers, usbDrivers, codes)) {
+            autodetectableDrivers = indexedDrivers;
+          }
+
+          free(codes);
+        }
       } else if (isBluetoothDevice(&dev)) {
         if (!(autodetectableDrivers = bthGetDriverCodes(dev, BLUETOOTH_DEVICE_NAME_OBTAIN_TIMEOUT))) {
           static const char *bluetoothDrivers[] = {
@@ -1781,6 +1971,7 @@ setSpeechFinished (volatile SpeechSynthesizer *spk) {
   spk->track.speechLocation = SPK_LOC_NONE;
 
   endAutospeakDelay(spk);
+  if (speechInputObject) setSpeechInputFinished(speechInputObject);
 }
 
 static void
@@ -2485,6 +2676,17 @@ brlttyStart (void) {
     logMessage(LOG_ERR, "%s: %s", gettext("invalid message hold timeout"), opt_messageHoldTimeout);
   }
 
+  if (*opt_ioCallbackLimit) {
+    static const int minimum = 0;
+    int limit;
+
+    if (validateInteger(&limit, opt_ioCallbackLimit, &minimum, NULL)) {
+      asyncSetIoCallbackLimit(limit);
+    } else {
+      logMessage(LOG_ERR, "%s: %s", gettext("invalid input/output callback limit"), opt_ioCallbackLimit);
+    }
+  }
+
   if (opt_version) {
     logMessage(LOG_INFO, "%s", PACKAGE_COPYRIGHT);
     identifyScreenDrivers(1);
@@ -2605,13 +2807,13 @@ brlttyStart (void) {
       changeStringSetting(&opt_textTable, "");
 
       if (name) {
-        if (replaceTextTable(opt_tablesDirectory, name)) {
+        if (changeTextTable(name)) {
           changeStringSetting(&opt_textTable, name);
         }
 
         free(name);
       }
-    } else if (!replaceTextTable(opt_tablesDirectory, opt_textTable)) {
+    } else if (!changeTextTable(opt_textTable)) {
       changeStringSetting(&opt_textTable, "");
     }
   }
@@ -2625,7 +2827,7 @@ brlttyStart (void) {
 
   /* handle attributes table option */
   if (*opt_attributesTable) {
-    if (!replaceAttributesTable(opt_tablesDirectory, opt_attributesTable)) {
+    if (!changeAttributesTable(opt_attributesTable)) {
       changeStringSetting(&opt_attributesTable, "");
     }
   }
@@ -2760,13 +2962,8 @@ endLanguageProfile (void) {
 #endif /* ENABLE_SPEECH_SUPPORT */
 
   if (brl.keyTable) {
-    char *path = makeBrailleKeyTablePath();
-
-    if (path) {
-      disableBrailleHelpPage();
-      makeBrailleHelpPage(path);
-      free(path);
-    }
+    disableBrailleHelpPage();
+    makeBrailleHelpPage();
   }
 
   if (keyboardTable) {
@@ -136,7 +136,7 @@ postprocessCommand (void *state, int command, int handled) {
 
   if (pre) {
     resumeUpdates(0);
-    if (handled) scheduleUpdate("command executed");
+    if (handled) scheduleInteractiveUpdate("command executed");
 
     if ((ses->winx != pre->motionColumn) || (ses->winy != pre->motionRow)) {
       /* The braille window has been manually moved. */
@@ -1110,6 +1110,15 @@ isDataFileIncluded (DataFile *file, const char *path) {
   return 0;
 }
 
+static DataFileOpenedHandler *dataFileOpenedHandler = NULL;
+static void *dataFileOpenedData = NULL;
+
+void
+setDataFileOpenedHandler (DataFileOpenedHandler *handler, void *data) {
+  dataFileOpenedHandler = handler;
+  dataFileOpenedData = data;
+}
+
 static FILE *
 openIncludedDataFile (DataFile *includer, const char *path, const char *mode, int optional) {
   const char *const *overrideDirectories = getAllOverrideDirectories();
@@ -1179,6 +1188,10 @@ openIncludedDataFile (DataFile *includer, const char *path, const char *mode, in
   }
 
 done:
+  if (file && !writable && dataFileOpenedHandler) {
+    dataFileOpenedHandler((overridePath? overridePath: path), dataFileOpenedData);
+  }
+
   if (overridePath) free(overridePath);
   return file;
 }
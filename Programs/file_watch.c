@@ -0,0 +1,252 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2016 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU General Public License, as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-GPL for details.
+ *
+ * Web Page: http://brltty.com/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+#include "prologue.h"
+
+#include <string.h>
+#include <errno.h>
+
+#include "log.h"
+#include "file_watch.h"
+#include "file.h"
+#include "io_misc.h"
+
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+
+#include "queue.h"
+#include "async_io.h"
+#include "async_alarm.h"
+
+#define FILE_WATCH_SETTLE_TIME 250
+#define FILE_WATCH_EVENT_MASK (IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE)
+
+typedef struct {
+  int identifier;
+  char *path;
+  const char *name;
+} FileWatchEntry;
+
+struct FileWatchObjectStruct {
+  FileWatchCallback *callback;
+  void *data;
+
+  int descriptor;
+  AsyncHandle inputMonitor;
+  AsyncHandle settleAlarm;
+  Queue *files;
+};
+
+static void
+deallocateFileWatchEntry (void *item, void *data) {
+  FileWatchEntry *file = item;
+
+  free(file->path);
+  free(file);
+}
+
+typedef struct {
+  int identifier;
+  const char *name;
+} FileWatchEntryTestData;
+
+static int
+testFileWatchEntry (const void *item, void *data) {
+  const FileWatchEntry *file = item;
+  const FileWatchEntryTestData *test = data;
+
+  if (file->identifier != test->identifier) return 0;
+  return strcmp(file->name, test->name) == 0;
+}
+
+static int
+testFileWatchPath (const void *item, void *data) {
+  const FileWatchEntry *file = item;
+  const char *path = data;
+
+  return strcmp(file->path, path) == 0;
+}
+
+ASYNC_ALARM_CALLBACK(handleFileWatchSettled) {
+  FileWatchObject *obj = parameters->data;
+
+  asyncDiscardHandle(obj->settleAlarm);
+  obj->settleAlarm = NULL;
+
+  obj->callback(obj->data);
+}
+
+static void
+handleFileChanged (FileWatchObject *obj, const FileWatchEntry *file) {
+  logMessage(LOG_DEBUG, "watched file changed: %s", file->path);
+
+  if (obj->settleAlarm) {
+    asyncResetAlarmIn(obj->settleAlarm, FILE_WATCH_SETTLE_TIME);
+  } else {
+    asyncSetAlarmIn(&obj->settleAlarm, FILE_WATCH_SETTLE_TIME, handleFileWatchSettled, obj);
+  }
+}
+
+ASYNC_INPUT_CALLBACK(handleFileWatchInput) {
+  FileWatchObject *obj = parameters->data;
+
+  if (parameters->error) {
+    logMessage(LOG_WARNING, "file watch input error: %s", strerror(parameters->error));
+  } else if (parameters->end) {
+    logMessage(LOG_WARNING, "file watch end-of-file");
+  } else {
+    const unsigned char *buffer = parameters->buffer;
+    size_t length = parameters->length;
+    size_t offset = 0;
+
+    while ((length - offset) >= sizeof(struct inotify_event)) {
+      const struct inotify_event *event = (const void *)&buffer[offset];
+      size_t size = sizeof(*event) + event->len;
+
+      if ((length - offset) < size) break;
+      offset += size;
+
+      if (event->len) {
+        const FileWatchEntryTestData test = {
+          .identifier = event->wd,
+          .name = event->name
+        };
+
+        const FileWatchEntry *file = findItem(obj->files, testFileWatchEntry, (void *)&test);
+        if (file) handleFileChanged(obj, file);
+      }
+    }
+
+    return offset;
+  }
+
+  asyncDiscardHandle(obj->inputMonitor);
+  obj->inputMonitor = NULL;
+  return 0;
+}
+
+FileWatchObject *
+newFileWatchObject (FileWatchCallback *callback, void *data) {
+  FileWatchObject *obj;
+
+  if ((obj = malloc(sizeof(*obj)))) {
+    memset(obj, 0, sizeof(*obj));
+    obj->callback = callback;
+    obj->data = data;
+    obj->inputMonitor = NULL;
+    obj->settleAlarm = NULL;
+
+    if ((obj->files = newQueue(deallocateFileWatchEntry, NULL))) {
+      if ((obj->descriptor = inotify_init()) != -1) {
+        setCloseOnExec(obj->descriptor, 1);
+
+        if (asyncReadFile(&obj->inputMonitor, obj->descriptor,
+                          0X1000, handleFileWatchInput, obj)) {
+          return obj;
+        }
+
+        close(obj->descriptor);
+      } else {
+        logSystemError("inotify_init");
+      }
+
+      deallocateQueue(obj->files);
+    }
+
+    free(obj);
+  } else {
+    logMallocError();
+  }
+
+  return NULL;
+}
+
+void
+destroyFileWatchObject (FileWatchObject *obj) {
+  if (obj->settleAlarm) asyncCancelRequest(obj->settleAlarm);
+  if (obj->inputMonitor) asyncCancelRequest(obj->inputMonitor);
+  close(obj->descriptor);
+  deallocateQueue(obj->files);
+  free(obj);
+}
+
+int
+addFileWatchPath (FileWatchObject *obj, const char *path) {
+  if (findItem(obj->files, testFileWatchPath, (void *)path)) return 1;
+
+  {
+    FileWatchEntry *file;
+
+    if ((file = malloc(sizeof(*file)))) {
+      memset(file, 0, sizeof(*file));
+
+      if ((file->path = strdup(path))) {
+        char *directory;
+
+        file->name = locatePathName(file->path);
+
+        /* The directory is watched rather than the file itself so that the
+         * file can still be followed after an editor has replaced it.
+         */
+        if ((directory = getPathDirectory(file->path))) {
+          file->identifier = inotify_add_watch(obj->descriptor, directory, FILE_WATCH_EVENT_MASK);
+
+          if (file->identifier != -1) {
+            free(directory);
+
+            if (enqueueItem(obj->files, file)) {
+              logMessage(LOG_DEBUG, "watching file: %s", path);
+              return 1;
+            }
+          } else {
+            logSystemError("inotify_add_watch");
+            free(directory);
+          }
+        }
+
+        free(file->path);
+      } else {
+        logMallocError();
+      }
+
+      free(file);
+    } else {
+      logMallocError();
+    }
+  }
+
+  return 0;
+}
+
+#else /* HAVE_SYS_INOTIFY_H */
+FileWatchObject *
+newFileWatchObject (FileWatchCallback *callback, void *data) {
+  logUnsupportedFunction();
+  return NULL;
+}
+
+void
+destroyFileWatchObject (FileWatchObject *obj) {
+}
+
+int
+addFileWatchPath (FileWatchObject *obj, const char *path) {
+  logUnsupportedFunction();
+  return 0;
+}
+#endif /* HAVE_SYS_INOTIFY_H */
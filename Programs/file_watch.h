@@ -0,0 +1,42 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2016 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU General Public License, as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-GPL for details.
+ *
+ * Web Page: http://brltty.com/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+#ifndef BRLTTY_INCLUDED_FILE_WATCH
+#define BRLTTY_INCLUDED_FILE_WATCH
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+typedef struct FileWatchObjectStruct FileWatchObject;
+
+#define FILE_WATCH_CALLBACK(name) void name (void *data)
+typedef FILE_WATCH_CALLBACK(FileWatchCallback);
+
+/* The callback is called, once a burst of changes has settled, after any of
+ * the watched files has been written, replaced, created, or removed.
+ */
+extern FileWatchObject *newFileWatchObject (FileWatchCallback *callback, void *data);
+extern void destroyFileWatchObject (FileWatchObject *obj);
+extern int addFileWatchPath (FileWatchObject *obj, const char *path);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* BRLTTY_INCLUDED_FILE_WATCH */
@@ -43,9 +43,12 @@
 #include <linux/uinput.h>
 
 #include "bitmask.h"
+#include "latency.h"
 #include "async_alarm.h"
 #include "async_io.h"
 
+#define KEYBOARD_EVENT_BUFFER_SIZE 0X40
+
 struct KeyboardMonitorExtensionStruct {
   struct {
     int socket;
@@ -67,6 +70,8 @@ struct KeyboardInstanceExtensionStruct {
     int major;
     int minor;
   } device;
+
+  LatencyHistogram eventLatencies;
 };
 
 BEGIN_KEY_CODE_MAP
@@ -477,6 +482,8 @@ newKeyboardInstanceExtension (KeyboardInstanceExtension **kix) {
     (*kix)->device.major = 0;
     (*kix)->device.minor = 0;
 
+    (*kix)->eventLatencies.name = "keyboard event";
+
     return 1;
   } else {
     logMallocError();
@@ -494,6 +501,7 @@ destroyKeyboardInstanceExtension (KeyboardInstanceExtension *kix) {
                kix->device.path, kix->file.descriptor);
   }
 
+  if (kix->eventLatencies.count) logLatencyHistogram(&kix->eventLatencies, LOG_DEBUG);
   if (kix->file.descriptor != -1) close(kix->file.descriptor);
   if (kix->udevDelay) asyncCancelRequest(kix->udevDelay);
   if (kix->uinput) destroyUinputObject(kix->uinput);
@@ -519,42 +527,74 @@ ASYNC_INPUT_CALLBACK(handleLinuxKeyboardEvent) {
                label, kio->kix->file.descriptor);
     destroyKeyboardInstanceObject(kio);
   } else {
+    /* All of the events which have been read are handled in one pass, and
+     * the ones which are forwarded are written together at the end of each
+     * report rather than one at a time.
+     */
+    UinputObject *uinput = kio->kix->uinput;
     const struct input_event *event = parameters->buffer;
+    const struct input_event *end = event + (parameters->length / sizeof(*event));
 
-    if (parameters->length >= sizeof(*event)) {
-      switch (event->type) {
-        case EV_KEY: {
-          int release = event->value == 0;
-          int press   = event->value == 1;
+    if (event < end) {
+      beginUinputBatch(uinput);
 
-          if (release || press) handleKeyEvent(kio, event->code, press);
-          break;
-        }
+      while (event < end) {
+        switch (event->type) {
+          case EV_KEY: {
+            int release = event->value == 0;
+            int press   = event->value == 1;
+
+            if (release || press) handleKeyEvent(kio, event->code, press);
+            break;
+          }
+
+          case EV_REP: {
+            switch (event->code) {
+              case REP_DELAY: {
+                writeRepeatDelay(uinput, event->value);
+                break;
+              }
 
-        case EV_REP: {
-          switch (event->code) {
-            case REP_DELAY: {
-              writeRepeatDelay(kio->kix->uinput, event->value);
-              break;
+              case REP_PERIOD: {
+                writeRepeatPeriod(uinput, event->value);
+                break;
+              }
+
+              default:
+                break;
             }
 
-            case REP_PERIOD: {
-              writeRepeatPeriod(kio->kix->uinput, event->value);
-              break;
+            break;
+          }
+
+          case EV_SYN: {
+            if (event->code == SYN_REPORT) {
+              endUinputBatch(uinput);
+              beginUinputBatch(uinput);
             }
 
-            default:
-              break;
+            break;
           }
 
-          break;
+          default:
+            break;
+        }
+
+        {
+          struct timeval now;
+          long int microseconds;
+
+          gettimeofday(&now, NULL);
+          microseconds = ((now.tv_sec - event->time.tv_sec) * USECS_PER_SEC)
+                       + (now.tv_usec - event->time.tv_usec);
+          addLatencySample(&kio->kix->eventLatencies, MAX(microseconds, 0));
         }
 
-        default:
-          break;
+        event += 1;
       }
 
-      return sizeof(*event);
+      endUinputBatch(uinput);
+      return (const unsigned char *)event - (const unsigned char *)parameters->buffer;
     }
   }
 
@@ -722,7 +762,8 @@ monitorKeyboard (KeyboardInstanceObject *kio) {
               if ((kio->kix->uinput = newUinputInstance(kio->kix->device.path))) {
                 if (prepareUinputInstance(kio->kix->uinput, kio->kix->file.descriptor)) {
                   if (asyncReadFile(&kio->kix->file.monitor,
-                                    kio->kix->file.descriptor, sizeof(struct input_event),
+                                    kio->kix->file.descriptor,
+                                    (sizeof(struct input_event) * KEYBOARD_EVENT_BUFFER_SIZE),
                                     handleLinuxKeyboardEvent, kio)) {
                     logMessage(LOG_DEBUG, "keyboard opened: %s: fd=%d",
                                kio->kix->device.path, kio->kix->file.descriptor);
@@ -0,0 +1,270 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2016 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU General Public License, as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-GPL for details.
+ *
+ * Web Page: http://brltty.com/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+/* Measure how long the BrlAPI server takes to find the client which gets
+ * a key: each client's accepted key ranges are searched in turn, the way
+ * whoGetsKey does it, for a range of client and key range counts. The
+ * indexed search is compared with a linear scan over the same ranges,
+ * which also verifies its results.
+ */
+
+#include "prologue.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "program.h"
+#include "options.h"
+#include "log.h"
+#include "parse.h"
+#include "timing.h"
+#include "brlapi_keyranges.h"
+
+static char *opt_clientCount;
+static char *opt_rangeCount;
+static char *opt_keyCount;
+
+BEGIN_OPTION_TABLE(programOptions)
+  { .letter = 'c',
+    .word = "clients",
+    .argument = "count",
+    .setting.string = &opt_clientCount,
+    .internal.setting = "64",
+    .description = "The largest number of clients."
+  },
+
+  { .letter = 'r',
+    .word = "ranges",
+    .argument = "count",
+    .setting.string = &opt_rangeCount,
+    .internal.setting = "1024",
+    .description = "The largest number of key ranges per client."
+  },
+
+  { .letter = 'k',
+    .word = "keys",
+    .argument = "count",
+    .setting.string = &opt_keyCount,
+    .internal.setting = "100000",
+    .description = "The number of keys to dispatch for each measurement."
+  },
+END_OPTION_TABLE
+
+/* Each range accepts a few consecutive key values with any flags.
+ * The ranges of all the clients are interleaved, with gaps between them,
+ * so that some keys don't go to any client.
+ */
+#define RANGE_WIDTH 4
+#define RANGE_STRIDE (RANGE_WIDTH * 2)
+
+static int
+getCount (unsigned int *count, const char *value, const char *name) {
+  static const int minimum = 1;
+  int integer;
+
+  if (!validateInteger(&integer, value, &minimum, NULL)) {
+    logMessage(LOG_ERR, "invalid %s count: %s", name, value);
+    return 0;
+  }
+
+  *count = integer;
+  return 1;
+}
+
+static int
+isKeyInRange (const Keyrange *range, KeyrangeElem key) {
+  uint32_t flags = KeyrangeFlags(key);
+  uint32_t value = KeyrangeVal(key);
+
+  return (range->minVal <= value) && (value <= range->maxVal) &&
+         ((flags | range->minFlags) == flags) &&
+         ((flags & ~range->maxFlags) == 0);
+}
+
+static int
+findClient_indexed (KeyrangeList *const *clients, unsigned int clientCount, KeyrangeElem key) {
+  for (unsigned int client=0; client<clientCount; client+=1) {
+    if (inKeyrangeList(clients[client], key)) return client;
+  }
+
+  return -1;
+}
+
+static int
+findClient_linear (KeyrangeList *const *clients, unsigned int clientCount, KeyrangeElem key) {
+  for (unsigned int client=0; client<clientCount; client+=1) {
+    const KeyrangeList *list = clients[client];
+
+    for (unsigned int index=0; index<list->count; index+=1) {
+      if (isKeyInRange(&list->ranges[index], key)) return client;
+    }
+  }
+
+  return -1;
+}
+
+typedef int ClientFinder (KeyrangeList *const *clients, unsigned int clientCount, KeyrangeElem key);
+
+static long int
+dispatchKeys (
+  ClientFinder *findClient,
+  KeyrangeList *const *clients, unsigned int clientCount,
+  const KeyrangeElem *keys, unsigned int keyCount,
+  int *results
+) {
+  TimeValue start;
+  TimeValue end;
+
+  getMonotonicTime(&start);
+
+  for (unsigned int key=0; key<keyCount; key+=1) {
+    results[key] = findClient(clients, clientCount, keys[key]);
+  }
+
+  getMonotonicTime(&end);
+  return microsecondsBetween(&start, &end);
+}
+
+static int
+measureDispatch (unsigned int clientCount, unsigned int rangeCount, KeyrangeElem *keys, unsigned int keyCount) {
+  int ok = 0;
+  KeyrangeList *clients[clientCount];
+
+  {
+    /* the same keys, spread over the values which the ranges span */
+    uint32_t limit = rangeCount * clientCount * RANGE_STRIDE;
+
+    srand(1);
+
+    for (unsigned int key=0; key<keyCount; key+=1) {
+      keys[key] = KeyrangeElem(rand() & 0XFF, (uint32_t)rand() % limit);
+    }
+  }
+
+  for (unsigned int client=0; client<clientCount; client+=1) clients[client] = NULL;
+
+  for (unsigned int client=0; client<clientCount; client+=1) {
+    /* add them in reverse order so that adding them is the worst case too */
+    unsigned int range = rangeCount;
+
+    while (range) {
+      uint32_t value = (((--range * clientCount) + client) * RANGE_STRIDE);
+
+      if (addKeyrange(KeyrangeElem(0, value),
+                      KeyrangeElem(UINT32_MAX, (value + RANGE_WIDTH - 1)),
+                      &clients[client]) == -1) {
+        logMallocError();
+        goto done;
+      }
+    }
+  }
+
+  {
+    int *indexedResults;
+
+    if ((indexedResults = malloc(ARRAY_SIZE(indexedResults, keyCount)))) {
+      int *linearResults;
+
+      if ((linearResults = malloc(ARRAY_SIZE(linearResults, keyCount)))) {
+        long int indexedTime = dispatchKeys(findClient_indexed, clients, clientCount, keys, keyCount, indexedResults);
+        long int linearTime = dispatchKeys(findClient_linear, clients, clientCount, keys, keyCount, linearResults);
+        unsigned int dispatched = 0;
+
+        ok = 1;
+
+        for (unsigned int key=0; key<keyCount; key+=1) {
+          if (indexedResults[key] != linearResults[key]) {
+            logMessage(LOG_ERR, "key %016" PRIX64 " dispatched to client %d instead of %d",
+                       keys[key], indexedResults[key], linearResults[key]);
+            ok = 0;
+            break;
+          }
+
+          if (indexedResults[key] != -1) dispatched += 1;
+        }
+
+        printf("clients=%u ranges=%u: indexed=%.3fus linear=%.3fus per key (%u%% dispatched)\n",
+               clientCount, rangeCount,
+               (double)indexedTime / keyCount, (double)linearTime / keyCount,
+               (dispatched * 100) / keyCount);
+
+        free(linearResults);
+      } else {
+        logMallocError();
+      }
+
+      free(indexedResults);
+    } else {
+      logMallocError();
+    }
+  }
+
+done:
+  for (unsigned int client=0; client<clientCount; client+=1) {
+    freeKeyrangeList(&clients[client]);
+  }
+
+  return ok;
+}
+
+int
+main (int argc, char *argv[]) {
+  ProgramExitStatus exitStatus = PROG_EXIT_SYNTAX;
+  unsigned int clientCount;
+  unsigned int rangeCount;
+  unsigned int keyCount;
+
+  {
+    static const OptionsDescriptor descriptor = {
+      OPTION_TABLE(programOptions),
+      .applicationName = "krbench"
+    };
+
+    PROCESS_OPTIONS(descriptor, argc, argv);
+  }
+
+  if (argc) {
+    logMessage(LOG_ERR, "too many parameters");
+  } else if (getCount(&clientCount, opt_clientCount, "client") &&
+             getCount(&rangeCount, opt_rangeCount, "range") &&
+             getCount(&keyCount, opt_keyCount, "key")) {
+    KeyrangeElem *keys;
+
+    exitStatus = PROG_EXIT_FATAL;
+
+    if ((keys = malloc(ARRAY_SIZE(keys, keyCount)))) {
+      exitStatus = PROG_EXIT_SUCCESS;
+
+      for (unsigned int clients=1; clients<=clientCount; clients*=4) {
+        for (unsigned int ranges=1; ranges<=rangeCount; ranges*=4) {
+          if (!measureDispatch(clients, ranges, keys, keyCount)) {
+            exitStatus = PROG_EXIT_FATAL;
+            goto done;
+          }
+        }
+      }
+
+    done:
+      free(keys);
+    } else {
+      logMallocError();
+    }
+  }
+
+  return exitStatus;
+}
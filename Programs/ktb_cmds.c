@@ -218,6 +218,7 @@ static const CommandListEntry commandList_special[] = {
   { .command = BRL_CMD_SPK_START },
   { .command = BRL_CMD_SCR_STOP },
   { .command = BRL_CMD_SCR_START },
+  { .command = BRL_CMD_UPDATE_STATS },
 };
 
 static const CommandListEntry commandList_internal[] = {
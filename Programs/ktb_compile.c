@@ -20,6 +20,7 @@
 
 #include <string.h>
 #include <ctype.h>
+#include <sys/stat.h>
 
 #include "log.h"
 #include "file.h"
@@ -189,6 +190,8 @@ getKeyContext (KeyTableData *ktd, unsigned char context) {
       ctx->keyBindings.size = 0;
       ctx->keyBindings.count = 0;
       ctx->keyBindings.sorted = NULL;
+      ctx->keyBindings.hash.table = NULL;
+      ctx->keyBindings.hash.mask = 0;
 
       ctx->hotkeys.table = NULL;
       ctx->hotkeys.count = 0;
@@ -1235,6 +1238,49 @@ compareKeyBindings (const KeyBinding *binding1, const KeyBinding *binding2) {
   return compareKeyCombinations(&binding1->keyCombination, &binding2->keyCombination);
 }
 
+static unsigned int
+hashKeyCombination (const KeyCombination *combination) {
+  unsigned int hash = 2166136261U;
+
+  if (combination->flags & KCF_IMMEDIATE_KEY) {
+    hash = (hash ^ combination->immediateKey.group) * 16777619U;
+    hash = (hash ^ combination->immediateKey.number) * 16777619U;
+  } else {
+    hash = (hash ^ 0XFFFF) * 16777619U;
+  }
+
+  {
+    const KeyValue *modifier = combination->modifierKeys;
+    const KeyValue *end = modifier + combination->modifierCount;
+
+    while (modifier < end) {
+      hash = (hash ^ modifier->group) * 16777619U;
+      hash = (hash ^ modifier->number) * 16777619U;
+      modifier += 1;
+    }
+  }
+
+  return hash;
+}
+
+const KeyBinding *
+getKeyBinding (const KeyContext *ctx, const KeyCombination *combination) {
+  const KeyBinding *const *table = ctx->keyBindings.hash.table;
+
+  if (table) {
+    unsigned int mask = ctx->keyBindings.hash.mask;
+    unsigned int index = hashKeyCombination(combination) & mask;
+    const KeyBinding *binding;
+
+    while ((binding = table[index])) {
+      if (!compareKeyCombinations(combination, &binding->keyCombination)) return binding;
+      index = (index + 1) & mask;
+    }
+  }
+
+  return NULL;
+}
+
 static int
 sortKeyBindings (const void *element1, const void *element2) {
   const KeyBinding *const *binding1 = element1;
@@ -1381,6 +1427,62 @@ done:
   return ok;
 }
 
+static int
+makeKeyBindingHash (KeyContext *ctx) {
+  unsigned int size = 0X10;
+
+  while (size < (ctx->keyBindings.count * 2)) size <<= 1;
+
+  if (!(ctx->keyBindings.hash.table = calloc(size, sizeof(*ctx->keyBindings.hash.table)))) {
+    logMallocError();
+    return 0;
+  }
+
+  ctx->keyBindings.hash.mask = size - 1;
+  BITMASK_ZERO(ctx->keyBindings.anyModifierGroups);
+  BITMASK_ZERO(ctx->keyBindings.anyImmediateGroups);
+
+  {
+    const KeyBinding *const *binding = ctx->keyBindings.sorted;
+    const KeyBinding *const *end = binding + ctx->keyBindings.count;
+
+    while (binding < end) {
+      const KeyCombination *combination = &(*binding)->keyCombination;
+      unsigned int index = hashKeyCombination(combination) & ctx->keyBindings.hash.mask;
+
+      /* keep the first of any duplicate combinations */
+      if (getKeyBinding(ctx, combination)) goto next;
+      while (ctx->keyBindings.hash.table[index]) index = (index + 1) & ctx->keyBindings.hash.mask;
+      ctx->keyBindings.hash.table[index] = *binding;
+
+      /* remember which groups wildcards are used for so that lookups */
+      /* only need to try replacing the keys of those groups */
+      {
+        unsigned int position;
+
+        for (position=0; position<combination->modifierCount; position+=1) {
+          const KeyValue *modifier = &combination->modifierKeys[position];
+
+          if (modifier->number == KTB_KEY_ANY) {
+            BITMASK_SET(ctx->keyBindings.anyModifierGroups, modifier->group);
+          }
+        }
+      }
+
+      if (combination->flags & KCF_IMMEDIATE_KEY) {
+        if (combination->immediateKey.number == KTB_KEY_ANY) {
+          BITMASK_SET(ctx->keyBindings.anyImmediateGroups, combination->immediateKey.group);
+        }
+      }
+
+    next:
+      binding += 1;
+    }
+  }
+
+  return 1;
+}
+
 static int
 prepareKeyBindings (KeyContext *ctx) {
   if (!addIncompleteBindings(ctx)) return 0;
@@ -1421,6 +1523,7 @@ prepareKeyBindings (KeyContext *ctx) {
     }
 
     qsort(ctx->keyBindings.sorted, ctx->keyBindings.count, sizeof(*ctx->keyBindings.sorted), sortKeyBindings);
+    if (!makeKeyBindingHash(ctx)) return 0;
   }
 
   return 1;
@@ -1557,8 +1660,10 @@ defineInitialKeyContexts (KeyTableData *ktd) {
   return 1;
 }
 
-KeyTable *
-compileKeyTable (const char *name, KEY_NAME_TABLES_REFERENCE keys) {
+static void destroyKeyTableData (KeyTable *table);
+
+static KeyTable *
+compileKeyTableData (const char *name, KEY_NAME_TABLES_REFERENCE keys) {
   KeyTable *table = NULL;
 
   if (setTableDataVariables(KEY_TABLE_EXTENSION, KEY_SUBTABLE_EXTENSION)) {
@@ -1575,6 +1680,7 @@ compileKeyTable (const char *name, KEY_NAME_TABLES_REFERENCE keys) {
     }
 
     if ((ktd.table = malloc(sizeof(*ktd.table)))) {
+      ktd.table->shared = NULL;
       ktd.table->title = NULL;
 
       ktd.table->notes.table = NULL;
@@ -1620,7 +1726,7 @@ compileKeyTable (const char *name, KEY_NAME_TABLES_REFERENCE keys) {
         }
       }
 
-      if (ktd.table) destroyKeyTable(ktd.table);
+      if (ktd.table) destroyKeyTableData(ktd.table);
     } else {
       logMallocError();
     }
@@ -1629,8 +1735,8 @@ compileKeyTable (const char *name, KEY_NAME_TABLES_REFERENCE keys) {
   return table;
 }
 
-void
-destroyKeyTable (KeyTable *table) {
+static void
+destroyKeyTableData (KeyTable *table) {
   resetLongPressData(table);
   setKeyAutoreleaseTime(table, 0);
 
@@ -1644,6 +1750,7 @@ destroyKeyTable (KeyTable *table) {
 
     if (ctx->keyBindings.table) free(ctx->keyBindings.table);
     if (ctx->keyBindings.sorted) free(ctx->keyBindings.sorted);
+    if (ctx->keyBindings.hash.table) free(ctx->keyBindings.hash.table);
 
     if (ctx->hotkeys.table) free(ctx->hotkeys.table);
     if (ctx->hotkeys.sorted) free(ctx->hotkeys.sorted);
@@ -1660,6 +1767,322 @@ destroyKeyTable (KeyTable *table) {
   free(table);
 }
 
+/* A compiled key table never changes once it's been built, so it's shared
+ * by every key table (e.g. one for each braille driver start) compiled from
+ * the same file for the same key names. Each of them only has its own
+ * state (the pressed keys, the current context, etc). A few unreferenced
+ * ones are kept in case the same table is wanted again (e.g. after a USB
+ * reset), and one is recompiled if any of its files have changed.
+ */
+#define SHARED_KEY_TABLE_UNREFERENCED_LIMIT 4
+
+typedef struct {
+  dev_t device;
+  ino_t inode;
+  off_t size;
+
+  /* a file may be rewritten within the same second, and possibly with the
+   * same size, so the sub-second times and the change time are checked too
+   */
+  time_t modified;
+  time_t changed;
+
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+  long int modifiedNanoseconds;
+  long int changedNanoseconds;
+#endif /* HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC */
+} KeyTableFileStatus;
+
+typedef struct {
+  char *path;
+  KeyTableFileStatus status;
+} KeyTableFile;
+
+struct SharedKeyTableStruct {
+  SharedKeyTable *next;
+  char *name;
+  KeyTable *table;
+  KEY_NAME_TABLES_REFERENCE keys;
+  unsigned int references;
+
+  unsigned isCached:1;
+  unsigned isStable:1;
+
+  struct {
+    KeyTableFile *table;
+    unsigned int size;
+    unsigned int count;
+  } files;
+};
+
+static SharedKeyTable *sharedKeyTables = NULL;
+
+static void
+deallocateSharedKeyTable (SharedKeyTable *shared) {
+  if (shared->table) destroyKeyTableData(shared->table);
+
+  while (shared->files.count) {
+    free(shared->files.table[--shared->files.count].path);
+  }
+
+  if (shared->files.table) free(shared->files.table);
+  if (shared->name) free(shared->name);
+  free(shared);
+}
+
+static void
+uncacheSharedKeyTable (SharedKeyTable *shared) {
+  SharedKeyTable **previous = &sharedKeyTables;
+
+  while (*previous) {
+    if (*previous == shared) {
+      *previous = shared->next;
+      break;
+    }
+
+    previous = &(*previous)->next;
+  }
+
+  shared->next = NULL;
+  shared->isCached = 0;
+}
+
+static void
+removeSharedKeyTable (SharedKeyTable *shared) {
+  uncacheSharedKeyTable(shared);
+  if (!shared->references) deallocateSharedKeyTable(shared);
+}
+
+static void
+pruneSharedKeyTables (void) {
+  SharedKeyTable *shared = sharedKeyTables;
+  unsigned int unreferenced = 0;
+
+  while (shared) {
+    SharedKeyTable *next = shared->next;
+
+    if (!shared->references) {
+      if (++unreferenced > SHARED_KEY_TABLE_UNREFERENCED_LIMIT) {
+        removeSharedKeyTable(shared);
+      }
+    }
+
+    shared = next;
+  }
+}
+
+static void
+exitSharedKeyTables (void *data) {
+  while (sharedKeyTables) removeSharedKeyTable(sharedKeyTables);
+}
+
+static int
+getKeyTableFileStatus (const char *path, KeyTableFileStatus *file) {
+  struct stat status;
+
+  if (stat(path, &status) == -1) return 0;
+  file->device = status.st_dev;
+  file->inode = status.st_ino;
+  file->size = status.st_size;
+  file->modified = status.st_mtime;
+  file->changed = status.st_ctime;
+
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+  file->modifiedNanoseconds = status.st_mtim.tv_nsec;
+  file->changedNanoseconds = status.st_ctim.tv_nsec;
+#endif /* HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC */
+
+  return 1;
+}
+
+static int
+isSameKeyTableFileStatus (const KeyTableFileStatus *status1, const KeyTableFileStatus *status2) {
+  if (status1->device != status2->device) return 0;
+  if (status1->inode != status2->inode) return 0;
+  if (status1->size != status2->size) return 0;
+  if (status1->modified != status2->modified) return 0;
+  if (status1->changed != status2->changed) return 0;
+
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+  if (status1->modifiedNanoseconds != status2->modifiedNanoseconds) return 0;
+  if (status1->changedNanoseconds != status2->changedNanoseconds) return 0;
+#endif /* HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC */
+
+  return 1;
+}
+
+static
+DATA_FILE_OPENED_HANDLER(addKeyTableFile) {
+  SharedKeyTable *shared = data;
+
+  if (shared->files.count == shared->files.size) {
+    unsigned int newSize = shared->files.size? shared->files.size<<1: 0X4;
+    KeyTableFile *newTable = realloc(shared->files.table, ARRAY_SIZE(newTable, newSize));
+
+    if (!newTable) {
+      logMallocError();
+      shared->isStable = 0;
+      return;
+    }
+
+    shared->files.table = newTable;
+    shared->files.size = newSize;
+  }
+
+  {
+    KeyTableFile *file = &shared->files.table[shared->files.count];
+
+    if (!getKeyTableFileStatus(path, &file->status)) {
+      shared->isStable = 0;
+    } else if (!(file->path = strdup(path))) {
+      logMallocError();
+      shared->isStable = 0;
+    } else {
+      shared->files.count += 1;
+    }
+  }
+}
+
+static int
+isSharedKeyTableCurrent (const SharedKeyTable *shared) {
+  for (unsigned int index=0; index<shared->files.count; index+=1) {
+    const KeyTableFile *file = &shared->files.table[index];
+    KeyTableFileStatus status;
+
+    if (!getKeyTableFileStatus(file->path, &status)) return 0;
+    if (!isSameKeyTableFileStatus(&status, &file->status)) return 0;
+  }
+
+  return 1;
+}
+
+static SharedKeyTable *
+findSharedKeyTable (const char *name, KEY_NAME_TABLES_REFERENCE keys) {
+  SharedKeyTable *shared = sharedKeyTables;
+
+  while (shared) {
+    SharedKeyTable *next = shared->next;
+
+    if ((shared->keys == keys) && (strcmp(shared->name, name) == 0)) {
+      if (isSharedKeyTableCurrent(shared)) return shared;
+
+      logMessage(LOG_DEBUG, "key table changed: %s", name);
+      removeSharedKeyTable(shared);
+    }
+
+    shared = next;
+  }
+
+  return NULL;
+}
+
+static SharedKeyTable *
+newSharedKeyTable (const char *name, KEY_NAME_TABLES_REFERENCE keys) {
+  SharedKeyTable *shared;
+
+  if ((shared = malloc(sizeof(*shared)))) {
+    memset(shared, 0, sizeof(*shared));
+    shared->next = NULL;
+    shared->name = NULL;
+    shared->keys = keys;
+    shared->references = 0;
+    shared->isCached = 0;
+    shared->isStable = 1;
+
+    shared->files.table = NULL;
+    shared->files.size = 0;
+    shared->files.count = 0;
+
+    setDataFileOpenedHandler(addKeyTableFile, shared);
+    shared->table = compileKeyTableData(name, keys);
+    setDataFileOpenedHandler(NULL, NULL);
+
+    if (shared->table) {
+      if (shared->isStable && shared->files.count) {
+        if (!(shared->name = strdup(name))) logMallocError();
+      }
+
+      if (shared->name) {
+        if (!sharedKeyTables) {
+          onProgramExit("shared-key-tables", exitSharedKeyTables, NULL);
+        }
+
+        shared->next = sharedKeyTables;
+        sharedKeyTables = shared;
+        shared->isCached = 1;
+      }
+
+      return shared;
+    }
+
+    deallocateSharedKeyTable(shared);
+  } else {
+    logMallocError();
+  }
+
+  return NULL;
+}
+
+KeyTable *
+compileKeyTable (const char *name, KEY_NAME_TABLES_REFERENCE keys) {
+  SharedKeyTable *shared = findSharedKeyTable(name, keys);
+
+  if (shared) {
+    logMessage(LOG_DEBUG, "sharing key table: %s", name);
+  } else if (!(shared = newSharedKeyTable(name, keys))) {
+    return NULL;
+  }
+
+  {
+    KeyTable *table;
+
+    if ((table = malloc(sizeof(*table)))) {
+      *table = *shared->table;
+      table->shared = shared;
+      shared->references += 1;
+
+      table->pressedKeys.table = NULL;
+      table->pressedKeys.size = 0;
+      table->pressedKeys.count = 0;
+
+      table->longPress.alarm = NULL;
+
+      table->autorelease.alarm = NULL;
+      table->autorelease.time = 0;
+
+      table->options.logLabel = NULL;
+      table->options.logKeyEventsFlag = NULL;
+      table->options.keyboardEnabledFlag = NULL;
+
+      resetKeyTable(table);
+      return table;
+    }
+
+    logMallocError();
+    if (!shared->isCached && !shared->references) deallocateSharedKeyTable(shared);
+  }
+
+  return NULL;
+}
+
+void
+destroyKeyTable (KeyTable *table) {
+  SharedKeyTable *shared = table->shared;
+
+  resetLongPressData(table);
+  setKeyAutoreleaseTime(table, 0);
+  if (table->pressedKeys.table) free(table->pressedKeys.table);
+  free(table);
+
+  if (!--shared->references) {
+    if (shared->isCached) {
+      pruneSharedKeyTables();
+    } else {
+      deallocateSharedKeyTable(shared);
+    }
+  }
+}
+
 char *
 ensureKeyTableExtension (const char *path) {
   return ensureFileExtension(path, KEY_TABLE_EXTENSION);
@@ -22,6 +22,7 @@
 #include "strfmth.h"
 #include "cmd_types.h"
 #include "async.h"
+#include "bitmask.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -100,6 +101,14 @@ typedef struct {
     unsigned int size;
     unsigned int count;
     const KeyBinding **sorted;
+
+    struct {
+      const KeyBinding **table;
+      unsigned int mask;
+    } hash;
+
+    BITMASK(anyModifierGroups, 0X100, char);
+    BITMASK(anyImmediateGroups, 0X100, char);
   } keyBindings;
 
   struct {
@@ -116,7 +125,11 @@ typedef struct {
   } mappedKeys;
 } KeyContext;
 
+typedef struct SharedKeyTableStruct SharedKeyTable;
+
 struct KeyTableStruct {
+  SharedKeyTable *shared;
+
   wchar_t *title;
 
   struct {
@@ -190,6 +203,7 @@ extern void removeKeyValue (KeyValue *values, unsigned int *count, unsigned int
 extern int deleteKeyValue (KeyValue *values, unsigned int *count, const KeyValue *value);
 
 extern int compareKeyBindings (const KeyBinding *binding1, const KeyBinding *binding2);
+extern const KeyBinding *getKeyBinding (const KeyContext *ctx, const KeyCombination *combination);
 
 extern STR_DECLARE_FORMATTER(formatKeyName, KeyTable *table, const KeyValue *value);
 
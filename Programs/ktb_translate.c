@@ -84,66 +84,87 @@ setKeyAutoreleaseTime (KeyTable *table, unsigned char setting) {
   setAutoreleaseAlarm(table);
 }
 
-static int
-sortModifierKeys (const void *element1, const void *element2) {
-  const KeyValue *modifier1 = element1;
-  const KeyValue *modifier2 = element2;
-  return compareKeyValues(modifier1, modifier2);
-}
+static void
+makeModifierKeys (KeyCombination *combination, const KeyValue *keys, unsigned int count, unsigned int any) {
+  KeyValue *modifier = combination->modifierKeys;
+  unsigned int index = 0;
+
+  /* The pressed keys are sorted, and the wildcard is the highest key number, */
+  /* so replacing keys within each group and moving them to the end of it */
+  /* keeps the modifiers sorted. */
+  while (index < count) {
+    KeyGroup group = keys[index].group;
+    unsigned int anyCount = 0;
+
+    do {
+      if (any & (1 << index)) {
+        anyCount += 1;
+      } else {
+        *modifier++ = keys[index];
+      }
+    } while ((++index < count) && (keys[index].group == group));
 
-static int
-searchKeyBinding (const void *target, const void *element) {
-  const KeyBinding *reference = target;
-  const KeyBinding *const *binding = element;
-  return compareKeyBindings(reference, *binding);
+    while (anyCount) {
+      modifier->group = group;
+      modifier->number = KTB_KEY_ANY;
+      modifier += 1;
+      anyCount -= 1;
+    }
+  }
 }
 
 static const KeyBinding *
 findKeyBinding (KeyTable *table, unsigned char context, const KeyValue *immediate, int *isIncomplete) {
   const KeyContext *ctx = getKeyContext(table, context);
 
-  if (ctx && ctx->keyBindings.sorted &&
+  if (ctx && ctx->keyBindings.hash.table &&
       (table->pressedKeys.count <= MAX_MODIFIERS_PER_COMBINATION)) {
-    KeyBinding target;
+    const KeyValue *keys = table->pressedKeys.table;
+    unsigned int count = table->pressedKeys.count;
+    unsigned int wildcards = 0;
+    KeyCombination target;
+
     memset(&target, 0, sizeof(target));
 
     if (immediate) {
-      target.keyCombination.immediateKey = *immediate;
-      target.keyCombination.flags |= KCF_IMMEDIATE_KEY;
+      target.immediateKey = *immediate;
+      target.flags |= KCF_IMMEDIATE_KEY;
     }
-    target.keyCombination.modifierCount = table->pressedKeys.count;
+    target.modifierCount = count;
 
-    while (1) {
-      unsigned int all = (1 << table->pressedKeys.count) - 1;
-      unsigned int bits;
+    {
+      unsigned int index;
 
-      for (bits=0; bits<=all; bits+=1) {
-        {
-          unsigned int index;
-          unsigned int bit;
+      for (index=0; index<count; index+=1) {
+        if (BITMASK_TEST(ctx->keyBindings.anyModifierGroups, keys[index].group)) {
+          wildcards |= 1 << index;
+        }
+      }
+    }
 
-          for (index=0, bit=1; index<table->pressedKeys.count; index+=1, bit<<=1) {
-            KeyValue *modifier = &target.keyCombination.modifierKeys[index];
+    while (1) {
+      unsigned int any = 0;
 
-            *modifier = table->pressedKeys.table[index];
-            if (bits & bit) modifier->number = KTB_KEY_ANY;
-          }
-        }
-        qsort(target.keyCombination.modifierKeys, table->pressedKeys.count, sizeof(*target.keyCombination.modifierKeys), sortModifierKeys);
+      /* Only the keys in groups for which a binding has a wildcard */
+      /* are worth replacing, so enumerate just the subsets of those. */
+      while (1) {
+        const KeyBinding *binding;
 
-        {
-          const KeyBinding *const *binding = bsearch(&target, ctx->keyBindings.sorted, ctx->keyBindings.count, sizeof(*ctx->keyBindings.sorted), searchKeyBinding);
+        makeModifierKeys(&target, keys, count, any);
 
-          if (binding) {
-            if ((*binding)->primaryCommand.value != EOF) return *binding;
-            *isIncomplete = 1;
-          }
+        if ((binding = getKeyBinding(ctx, &target))) {
+          if (binding->primaryCommand.value != EOF) return binding;
+          *isIncomplete = 1;
         }
+
+        if (any == wildcards) break;
+        any = (any - wildcards) & wildcards;
       }
 
-      if (!(target.keyCombination.flags & KCF_IMMEDIATE_KEY)) break;
-      if (target.keyCombination.immediateKey.number == KTB_KEY_ANY) break;
-      target.keyCombination.immediateKey.number = KTB_KEY_ANY;
+      if (!(target.flags & KCF_IMMEDIATE_KEY)) break;
+      if (target.immediateKey.number == KTB_KEY_ANY) break;
+      if (!BITMASK_TEST(ctx->keyBindings.anyImmediateGroups, target.immediateKey.group)) break;
+      target.immediateKey.number = KTB_KEY_ANY;
     }
   }
 
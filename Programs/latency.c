@@ -0,0 +1,129 @@
+/*
+ * BRLTTY - A background process providing access to the console screen (when in
+ *          text mode) for a blind person using a refreshable braille display.
+ *
+ * Copyright (C) 1995-2016 by The BRLTTY Developers.
+ *
+ * BRLTTY comes with ABSOLUTELY NO WARRANTY.
+ *
+ * This is free software, placed under the terms of the
+ * GNU General Public License, as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any
+ * later version. Please see the file LICENSE-GPL for details.
+ *
+ * Web Page: http://brltty.com/
+ *
+ * This software is maintained by Dave Mielke <dave@mielke.cc>.
+ */
+
+#include "prologue.h"
+
+#include <string.h>
+
+#include "log.h"
+#include "latency.h"
+#include "strfmt.h"
+
+void
+resetLatencyHistogram (LatencyHistogram *histogram) {
+  const char *name = histogram->name;
+
+  memset(histogram, 0, sizeof(*histogram));
+  histogram->name = name;
+}
+
+void
+addLatencySample (LatencyHistogram *histogram, unsigned long int microseconds) {
+  unsigned int bucket = 0;
+
+  {
+    unsigned long int value = microseconds;
+
+    while (value && (bucket < (LATENCY_BUCKET_COUNT - 1))) {
+      value >>= 1;
+      bucket += 1;
+    }
+  }
+
+  histogram->buckets[bucket] += 1;
+  histogram->total += microseconds;
+
+  if (!histogram->count++ || (microseconds < histogram->minimum)) histogram->minimum = microseconds;
+  if (microseconds > histogram->maximum) histogram->maximum = microseconds;
+}
+
+/* The current time then becomes the start so that consecutive intervals
+ * can be chained.
+ */
+void
+addLatencySince (LatencyHistogram *histogram, TimeValue *start) {
+  TimeValue now;
+  long int elapsed;
+
+  getMonotonicTime(&now);
+  elapsed = microsecondsBetween(start, &now);
+  addLatencySample(histogram, ((elapsed > 0)? elapsed: 0));
+  *start = now;
+}
+
+unsigned long int
+getLatencyAverage (const LatencyHistogram *histogram) {
+  if (!histogram->count) return 0;
+  return histogram->total / histogram->count;
+}
+
+unsigned long int
+getLatencyPercentile (const LatencyHistogram *histogram, unsigned int percent) {
+  if (histogram->count) {
+    unsigned long int threshold = ((histogram->count * percent) + 99) / 100;
+    unsigned long int count = 0;
+    unsigned int bucket;
+
+    for (bucket=0; bucket<LATENCY_BUCKET_COUNT; bucket+=1) {
+      if ((count += histogram->buckets[bucket]) >= threshold) {
+        /* report the upper bound of the bucket, but never beyond the maximum */
+        unsigned long int limit = bucket? ((1UL << bucket) - 1): 0;
+        return MIN(limit, histogram->maximum);
+      }
+    }
+  }
+
+  return histogram->maximum;
+}
+
+STR_BEGIN_FORMATTER(formatLatencyHistogram, const LatencyHistogram *histogram)
+  STR_PRINTF("%s: n=%lu", histogram->name, histogram->count);
+
+  if (histogram->count) {
+    STR_PRINTF(
+      " min=%luus avg=%luus p99=%luus max=%luus",
+      histogram->minimum, getLatencyAverage(histogram),
+      getLatencyPercentile(histogram, 99), histogram->maximum
+    );
+  }
+STR_END_FORMATTER
+
+void
+logLatencyHistogram (const LatencyHistogram *histogram, int level) {
+  char buffer[0X100];
+
+  formatLatencyHistogram(buffer, sizeof(buffer), histogram);
+  logMessage(level, "%s", buffer);
+
+  if (histogram->count) {
+    unsigned int bucket;
+
+    STR_BEGIN(buffer, sizeof(buffer));
+
+    for (bucket=0; bucket<LATENCY_BUCKET_COUNT; bucket+=1) {
+      unsigned long int count = histogram->buckets[bucket];
+
+      if (count) {
+        STR_PRINTF(" <%lu:%lu", (1UL << bucket), count);
+      }
+    }
+
+    STR_END;
+    logMessage(level, "%s buckets:%s", histogram->name, buffer);
+  }
+}
@@ -46,6 +46,9 @@ extern "C" {
 #define SCREEN_DRIVER_START_RETRY_INTERVAL 5000
 #define SCREEN_FREEZE_REMINDER_INTERVAL 30000
 #define SCREEN_UPDATE_POLL_INTERVAL 40
+#define SCREEN_UPDATE_POLL_INTERVAL_MINIMUM 20
+#define SCREEN_UPDATE_POLL_INTERVAL_MAXIMUM 320
+#define SCREEN_UPDATE_POLL_IDLE_THRESHOLD 25
 #define SCREEN_UPDATE_SCHEDULE_DELAY 5
 
 #define KEYBOARD_MONITOR_START_RETRY_INTERVAL 5000
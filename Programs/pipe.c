@@ -98,12 +98,14 @@ stopInputMonitor (NamedPipeObject *obj) {
 
 ASYNC_INPUT_CALLBACK(handleNamedPipeInput) {
   NamedPipeObject *obj = parameters->data;
+  int end = 0;
 
   if (parameters->error) {
     logMessage(LOG_WARNING, "named pipe input error: %s: %s",
                obj->host.path, strerror(parameters->error));
   } else if (parameters->end) {
     logMessage(LOG_WARNING, "named pipe end-of-file: %s", obj->host.path);
+    end = 1;
   } else {
     const NamedPipeInputCallbackParameters input = {
       .buffer = parameters->buffer,
@@ -120,6 +122,18 @@ ASYNC_INPUT_CALLBACK(handleNamedPipeInput) {
   if (obj->resetPipe) obj->resetPipe(obj);
   obj->monitorPipe(obj);
 
+  if (end) {
+    /* the callback may still be holding an unterminated line */
+    const NamedPipeInputCallbackParameters input = {
+      .buffer = parameters->buffer,
+      .length = parameters->length,
+      .data = obj->data,
+      .end = 1
+    };
+
+    obj->callback(&input);
+  }
+
   return 0;
 }
 
@@ -341,6 +355,23 @@ newNamedPipeObject (const char *name, NamedPipeInputCallback *callback, void *da
   return NULL;
 }
 
+void
+suspendNamedPipeInput (NamedPipeObject *obj) {
+  if (obj->input.monitor) {
+    logMessage(LOG_DEBUG, "suspending named pipe input: %s", obj->host.path);
+    stopInputMonitor(obj);
+  }
+}
+
+int
+resumeNamedPipeInput (NamedPipeObject *obj) {
+  if (!obj->input.monitor) {
+    logMessage(LOG_DEBUG, "resuming named pipe input: %s", obj->host.path);
+  }
+
+  return monitorInput(obj);
+}
+
 void
 destroyNamedPipeObject (NamedPipeObject *obj) {
   logMessage(LOG_DEBUG, "destroying named pipe: %s", obj->host.path);
@@ -29,6 +29,7 @@ typedef struct {
   const unsigned char *buffer;
   size_t length;
   void *data;
+  unsigned end:1; /* the writer has closed the pipe */
 } NamedPipeInputCallbackParameters;
 
 #define NAMED_PIPE_INPUT_CALLBACK(name) size_t name (const NamedPipeInputCallbackParameters *parameters)
@@ -37,6 +38,12 @@ typedef NAMED_PIPE_INPUT_CALLBACK(NamedPipeInputCallback);
 extern NamedPipeObject *newNamedPipeObject (const char *name, NamedPipeInputCallback *callback, void *data);
 extern void destroyNamedPipeObject (NamedPipeObject *obj);
 
+/* While suspended, nothing is read, so writers block once the pipe is full.
+ * Any input which has already been passed to the callback has been consumed.
+ */
+extern void suspendNamedPipeInput (NamedPipeObject *obj);
+extern int resumeNamedPipeInput (NamedPipeObject *obj);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -250,6 +250,11 @@ clearHelpPage (void) {
   return helpScreen.clearPage();
 }
 
+int
+setHelpPageGenerator (HelpPageGenerator *generator, void *data) {
+  return helpScreen.setPageGenerator(generator, data);
+}
+
 int
 addHelpLine (const wchar_t *characters) {
   return helpScreen.addLine(characters);
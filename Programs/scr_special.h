@@ -20,6 +20,7 @@
 #define BRLTTY_INCLUDED_SCR_SPECIAL
 
 #include "scr_internal.h"
+#include "scr_help.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -45,6 +46,7 @@ extern unsigned int getHelpPageCount (void);
 extern unsigned int getHelpPageNumber (void);
 extern int setHelpPageNumber (unsigned int number);
 extern int clearHelpPage (void);
+extern int setHelpPageGenerator (HelpPageGenerator *generator, void *data);
 extern int addHelpLine (const wchar_t *characters);
 extern unsigned int getHelpLineCount (void);
 
@@ -26,6 +26,7 @@
 #include "parse.h"
 #include "device.h"
 #include "async_wait.h"
+#include "async_alarm.h"
 
 #if defined(USE_PKG_SERIAL_NONE)
 #include "serial_none.h"
@@ -161,62 +162,111 @@ serialSetParity (SerialDevice *serial, SerialParity parity) {
   return 0;
 }
 
-#ifdef HAVE_POSIX_THREADS
+/* Emulated flow control is driven by the event loop: the modem lines are
+ * checked by an alarm as well as before each read and write. The alarm
+ * polls quickly while the handshake is busy (since the last CTS change or
+ * write) and backs off, by doubling its interval, once it goes quiet.
+ */
+#define SERIAL_FLOW_CONTROL_INTERVAL_MINIMUM 10
+#define SERIAL_FLOW_CONTROL_INTERVAL_MAXIMUM 320
+#define SERIAL_FLOW_CONTROL_BUSY_TIME 1000
+
+static void
+serialStopFlowControl (SerialDevice *serial) {
+  if (serial->flowControlAlarm) {
+    asyncCancelRequest(serial->flowControlAlarm);
+    serial->flowControlAlarm = NULL;
+  }
+}
+
 static void
 serialFlowControlProc_inputCTS (SerialDevice *serial) {
-  int up = serialTestLineCTS(serial);
+  /* RTS acknowledges each change of CTS by following it */
+  if (serialGetLines(serial)) {
+    int cts = !!(serial->linesState & SERIAL_LINE_CTS);
+    int rts = !!(serial->linesState & SERIAL_LINE_RTS);
+    TimeValue now;
+
+    getMonotonicTime(&now);
+
+    if (cts != rts) {
+      serialSetLineRTS(serial, cts);
+
+      logMessage(LOG_CATEGORY(SERIAL_IO),
+                 "CTS %s acknowledged: detected < %ldus",
+                 (cts? "up": "down"),
+                 (long int)microsecondsBetween(&serial->flowControlTime, &now));
 
-  while (!serial->flowControlStop) {
-    serialSetLineRTS(serial, up);
-    serialWaitLineCTS(serial, (up = !up), 0);
+      serial->flowControlEdgeTime = now;
+      serial->flowControlBusyTime = now;
+      serial->flowControlEdgePending = 1;
+    }
+
+    serial->flowControlTime = now;
+  } else {
+    logMessage(LOG_WARNING, "serial flow control emulation disabled");
+    serialStopFlowControl(serial);
+    serial->currentFlowControlProc = NULL;
+    serial->pendingFlowControlProc = NULL;
   }
 }
 
-THREAD_FUNCTION(serialFlowControlThread) {
-  SerialDevice *serial = argument;
+ASYNC_ALARM_CALLBACK(serialHandleFlowControlAlarm) {
+  SerialDevice *serial = parameters->data;
+
+  asyncDiscardHandle(serial->flowControlAlarm);
+  serial->flowControlAlarm = NULL;
 
   serial->currentFlowControlProc(serial);
-  return NULL;
+  if (!serial->currentFlowControlProc) return;
+
+  if (getMonotonicElapsed(&serial->flowControlBusyTime) < SERIAL_FLOW_CONTROL_BUSY_TIME) {
+    serial->flowControlInterval = SERIAL_FLOW_CONTROL_INTERVAL_MINIMUM;
+  } else if (serial->flowControlInterval < SERIAL_FLOW_CONTROL_INTERVAL_MAXIMUM) {
+    serial->flowControlInterval = MIN((serial->flowControlInterval * 2),
+                                      SERIAL_FLOW_CONTROL_INTERVAL_MAXIMUM);
+  }
+
+  if (!asyncSetAlarmIn(&serial->flowControlAlarm, serial->flowControlInterval,
+                       serialHandleFlowControlAlarm, serial)) {
+    logMessage(LOG_WARNING, "serial flow control polling stopped");
+  }
 }
 
 static int
-serialStartFlowControlThread (SerialDevice *serial) {
-  if (!serial->flowControlRunning && serial->currentFlowControlProc) {
-    pthread_t thread;
-    pthread_attr_t attributes;
-
-    pthread_attr_init(&attributes);
-    pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
-
-    serial->flowControlStop = 0;
-    if (createThread("serial-input-cts", &thread, &attributes,
-                     serialFlowControlThread, serial)) {
-      logSystemError("pthread_create");
+serialStartFlowControl (SerialDevice *serial) {
+  if (!serial->flowControlAlarm && serial->currentFlowControlProc) {
+    getMonotonicTime(&serial->flowControlTime);
+    serial->flowControlBusyTime = serial->flowControlTime;
+    serial->flowControlEdgePending = 0;
+    serial->flowControlInterval = SERIAL_FLOW_CONTROL_INTERVAL_MINIMUM;
+
+    if (!asyncSetAlarmIn(&serial->flowControlAlarm, 0,
+                         serialHandleFlowControlAlarm, serial)) {
       return 0;
     }
-
-    serial->flowControlThread = thread;
-    serial->flowControlRunning = 1;
   }
 
   return 1;
 }
 
 static void
-serialStopFlowControlThread (SerialDevice *serial) {
-  if (serial->flowControlRunning) {
-    serial->flowControlStop = 1;
-    serial->flowControlRunning = 0;
+serialBusyFlowControl (SerialDevice *serial) {
+  if (serial->flowControlAlarm) {
+    getMonotonicTime(&serial->flowControlBusyTime);
+
+    if (serial->flowControlInterval > SERIAL_FLOW_CONTROL_INTERVAL_MINIMUM) {
+      serial->flowControlInterval = SERIAL_FLOW_CONTROL_INTERVAL_MINIMUM;
+      asyncResetAlarmIn(serial->flowControlAlarm, serial->flowControlInterval);
+    }
   }
 }
-#endif /* HAVE_POSIX_THREADS */
 
 int
 serialSetFlowControl (SerialDevice *serial, SerialFlowControl flow) {
   logMessage(LOG_CATEGORY(SERIAL_IO), "set flow control: 0X%02X", flow);
   flow = serialPutFlowControl(&serial->pendingAttributes, flow);
 
-#ifdef HAVE_POSIX_THREADS
   if (flow & SERIAL_FLOW_INPUT_CTS) {
     flow &= ~SERIAL_FLOW_INPUT_CTS;
     serial->pendingFlowControlProc = serialFlowControlProc_inputCTS;
@@ -231,7 +281,6 @@ serialSetFlowControl (SerialDevice *serial, SerialFlowControl flow) {
       logMessage(LOG_WARNING, "unsupported serial modem state: %d", state);
     }
   }
-#endif /* HAVE_POSIX_THREADS */
 
   if (!flow) return 1;
   logMessage(LOG_WARNING, "unsupported serial flow control: 0X%02X", flow);
@@ -327,19 +376,18 @@ serialWriteAttributes (SerialDevice *serial, const SerialAttributes *attributes)
 
 static int
 serialFlushAttributes (SerialDevice *serial) {
-#ifdef HAVE_POSIX_THREADS
-  int restartFlowControlThread = serial->pendingFlowControlProc != serial->currentFlowControlProc;
-  if (restartFlowControlThread) serialStopFlowControlThread(serial);
-#endif /* HAVE_POSIX_THREADS */
+  int restartFlowControl = serial->pendingFlowControlProc != serial->currentFlowControlProc;
+  if (restartFlowControl) serialStopFlowControl(serial);
 
   if (!serialWriteAttributes(serial, &serial->pendingAttributes)) return 0;
 
-#ifdef HAVE_POSIX_THREADS
-  if (restartFlowControlThread) {
+  if (restartFlowControl) {
     serial->currentFlowControlProc = serial->pendingFlowControlProc;
-    if (!serialStartFlowControlThread(serial)) return 0;
+    if (!serialStartFlowControl(serial)) return 0;
   }
-#endif /* HAVE_POSIX_THREADS */
+
+  /* don't let data be transferred before the lines are up to date */
+  if (serial->currentFlowControlProc) serial->currentFlowControlProc(serial);
 
   return 1;
 }
@@ -416,7 +464,27 @@ serialWriteData (
 ) {
   if (!serialFlushAttributes(serial)) return -1;
   if (size > 0) logBytes(LOG_CATEGORY(SERIAL_IO), "output", data, size);
-  return serialPutData(serial, data, size);
+
+  {
+    ssize_t result = serialPutData(serial, data, size);
+
+    if (serial->currentFlowControlProc) {
+      if ((result > 0) && serial->flowControlEdgePending) {
+        TimeValue now;
+
+        getMonotonicTime(&now);
+        serial->flowControlEdgePending = 0;
+
+        logMessage(LOG_CATEGORY(SERIAL_IO),
+                   "output released by CTS change: latency=%ldus",
+                   (long int)microsecondsBetween(&serial->flowControlEdgeTime, &now));
+      }
+
+      serialBusyFlowControl(serial);
+    }
+
+    return result;
+  }
 }
 
 static int
@@ -538,11 +606,9 @@ serialPrepareDevice (SerialDevice *serial) {
     serial->linesState = 0;
     serial->waitLines = 0;
 
-#ifdef HAVE_POSIX_THREADS
     serial->currentFlowControlProc = NULL;
     serial->pendingFlowControlProc = NULL;
-    serial->flowControlRunning = 0;
-#endif /* HAVE_POSIX_THREADS */
+    serial->flowControlAlarm = NULL;
 
     return 1;
   }
@@ -750,9 +816,7 @@ serialOpenDevice (const char *identifier) {
 
 void
 serialCloseDevice (SerialDevice *serial) {
-#ifdef HAVE_POSIX_THREADS
-  serialStopFlowControlThread(serial);
-#endif /* HAVE_POSIX_THREADS */
+  serialStopFlowControl(serial);
 
   serialWriteAttributes(serial, &serial->originalAttributes);
 
@@ -773,9 +837,7 @@ serialRestartDevice (SerialDevice *serial, unsigned int baud) {
   SerialLines lowLines = 0;
   int usingB0;
 
-#ifdef HAVE_POSIX_THREADS
   SerialFlowControlProc *flowControlProc = serial->pendingFlowControlProc;
-#endif /* HAVE_POSIX_THREADS */
 
   logMessage(LOG_CATEGORY(SERIAL_IO), "restarting");
 
@@ -790,9 +852,7 @@ serialRestartDevice (SerialDevice *serial, unsigned int baud) {
 
   if (!serialDiscardOutput(serial)) return 0;
 
-#ifdef HAVE_POSIX_THREADS
   serial->pendingFlowControlProc = NULL;
-#endif /* HAVE_POSIX_THREADS */
 
 #ifdef B0
   if (!serialPutSpeed(&serial->pendingAttributes, B0)) return 0;
@@ -834,9 +894,7 @@ serialRestartDevice (SerialDevice *serial, unsigned int baud) {
     if (!serialWriteLines(serial, highLines, lowLines))
       return 0;
 
-#ifdef HAVE_POSIX_THREADS
   serial->pendingFlowControlProc = flowControlProc;
-#endif /* HAVE_POSIX_THREADS */
 
   if (!serialSetBaud(serial, baud)) return 0;
   if (!serialFlushAttributes(serial)) return 0;
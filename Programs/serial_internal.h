@@ -25,6 +25,8 @@
 
 #include "io_serial.h"
 #include "thread.h"
+#include "async.h"
+#include "timing.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -43,13 +45,14 @@ struct SerialDeviceStruct {
   SerialLines linesState;
   SerialLines waitLines;
 
-#ifdef HAVE_POSIX_THREADS
   SerialFlowControlProc *currentFlowControlProc;
   SerialFlowControlProc *pendingFlowControlProc;
-  pthread_t flowControlThread;
-  unsigned flowControlRunning:1;
-  unsigned flowControlStop:1;
-#endif /* HAVE_POSIX_THREADS */
+  AsyncHandle flowControlAlarm;
+  int flowControlInterval;
+  TimeValue flowControlTime; /* when the lines were last checked */
+  TimeValue flowControlBusyTime; /* when the handshake was last active */
+  TimeValue flowControlEdgeTime; /* when CTS last changed */
+  unsigned flowControlEdgePending:1; /* no output since CTS last changed */
 
   SerialPackageFields package;
 };
@@ -24,26 +24,359 @@
 #include "spk_input.h"
 #include "spk.h"
 #include "pipe.h"
+#include "queue.h"
+#include "charset.h"
+#include "async_alarm.h"
 #include "core.h"
 
 #ifdef ENABLE_SPEECH_SUPPORT
+/* Each line written to the speech input pipe is an utterance. It may begin
+ * with a header: SPEECH_INPUT_HEADER, an optional priority digit (0 lowest,
+ * 9 highest), optional flags, and then a space. The only flag is 'i', which
+ * means that the utterance may be interrupted, or dropped before it's spoken,
+ * by newer text of the same or a higher priority.
+ */
+#define SPEECH_INPUT_HEADER 0X01
+#define SPEECH_INPUT_DEFAULT_PRIORITY 5
+#define SPEECH_INPUT_FLAG_INTERRUPTIBLE 'i'
+
+/* When this many utterances are waiting to be spoken, the pipe isn't read
+ * until one of them has been, so writers are held back by the pipe itself.
+ */
+#define SPEECH_INPUT_QUEUE_LIMIT 20
+
+/* Most speech drivers don't report when they've finished speaking, so an
+ * utterance is also considered to have been spoken after about this long.
+ */
+#define SPEECH_INPUT_CHARACTER_TIME 80
+#define SPEECH_INPUT_MINIMUM_TIME 500
+
+/* A line which has been written without its newline is spoken anyway if
+ * the rest of it hasn't arrived within this long.
+ */
+#define SPEECH_INPUT_FRAGMENT_TIME 500
+
+typedef struct {
+  unsigned char priority;
+  unsigned interruptible:1;
+} SpeechInputProperties;
+
+typedef struct {
+  SpeechInputProperties properties;
+  char *text;
+} SpeechInputUtterance;
+
 struct SpeechInputObjectStruct {
   NamedPipeObject *pipe;
+  Queue *utterances;
+
+  struct {
+    SpeechInputProperties properties;
+    AsyncHandle alarm;
+    unsigned active:1;
+  } current;
+
+  struct {
+    unsigned char *buffer;
+    size_t length;
+    AsyncHandle alarm;
+    unsigned busy:1;
+    unsigned suspended:1;
+  } held;
 };
 
+static void
+deallocateSpeechInputUtterance (void *item, void *data) {
+  SpeechInputUtterance *utterance = item;
+
+  free(utterance->text);
+  free(utterance);
+}
+
+static int
+compareSpeechInputUtterances (const void *newItem, const void *existingItem, void *queueData) {
+  const SpeechInputUtterance *newUtterance = newItem;
+  const SpeechInputUtterance *existingUtterance = existingItem;
+
+  return newUtterance->properties.priority > existingUtterance->properties.priority;
+}
+
+static int
+testStaleSpeechInputUtterance (const void *item, void *data) {
+  const SpeechInputUtterance *utterance = item;
+  const SpeechInputProperties *newer = data;
+
+  return utterance->properties.interruptible &&
+         (utterance->properties.priority <= newer->priority);
+}
+
+static void
+stopSpeechInputAlarm (SpeechInputObject *obj) {
+  if (obj->current.alarm) {
+    asyncCancelRequest(obj->current.alarm);
+    obj->current.alarm = NULL;
+  }
+}
+
+static void sayNextSpeechInputUtterance (SpeechInputObject *obj, SayOptions options);
+
+ASYNC_ALARM_CALLBACK(handleSpeechInputAlarm) {
+  SpeechInputObject *obj = parameters->data;
+
+  asyncDiscardHandle(obj->current.alarm);
+  obj->current.alarm = NULL;
+
+  obj->current.active = 0;
+  sayNextSpeechInputUtterance(obj, 0);
+}
+
+static int
+addSpeechInputUtterance (SpeechInputObject *obj, const SpeechInputProperties *properties, const char *text, size_t length) {
+  {
+    Element *element;
+
+    while ((element = findElement(obj->utterances, testStaleSpeechInputUtterance, (void *)properties))) {
+      deleteElement(element);
+    }
+  }
+
+  if (getQueueSize(obj->utterances) >= SPEECH_INPUT_QUEUE_LIMIT) return 0;
+
+  {
+    SpeechInputUtterance *utterance;
+
+    if ((utterance = malloc(sizeof(*utterance)))) {
+      memset(utterance, 0, sizeof(*utterance));
+      utterance->properties = *properties;
+
+      if ((utterance->text = malloc(length + 1))) {
+        memcpy(utterance->text, text, length);
+        utterance->text[length] = 0;
+
+        if (enqueueItem(obj->utterances, utterance)) return 1;
+        free(utterance->text);
+      } else {
+        logMallocError();
+      }
+
+      free(utterance);
+    } else {
+      logMallocError();
+    }
+  }
+
+  return -1;
+}
+
+static size_t
+parseSpeechInputHeader (const char *line, size_t length, SpeechInputProperties *properties) {
+  const char *from = line;
+  const char *end = from + length;
+
+  properties->priority = SPEECH_INPUT_DEFAULT_PRIORITY;
+  properties->interruptible = 0;
+
+  if ((from == end) || (*from != SPEECH_INPUT_HEADER)) return 0;
+  from += 1;
+
+  if ((from < end) && (*from >= '0') && (*from <= '9')) {
+    properties->priority = *from++ - '0';
+  }
+
+  while ((from < end) && (*from != ' ')) {
+    if (*from == SPEECH_INPUT_FLAG_INTERRUPTIBLE) {
+      properties->interruptible = 1;
+    } else {
+      logMessage(LOG_WARNING, "unknown speech input flag: %c", *from);
+    }
+
+    from += 1;
+  }
+
+  if (from < end) from += 1;
+  return from - line;
+}
+
+static size_t
+processSpeechInput (SpeechInputObject *obj, const unsigned char *buffer, size_t length, int final) {
+  const char *text = (const char *)buffer;
+  const char *end = text + length;
+  SayOptions options = 0;
+
+  while (text < end) {
+    const char *newline = memchr(text, '\n', end - text);
+    const char *next = newline? newline + 1: end;
+    size_t count = (newline? newline: end) - text;
+    SpeechInputProperties properties;
+    size_t header;
+
+    /* wait for the rest of the line */
+    if (!newline && !final) break;
+
+    if (count && (text[count-1] == '\r')) count -= 1;
+    header = parseSpeechInputHeader(text, count, &properties);
+
+    if (count > header) {
+      int added = addSpeechInputUtterance(obj, &properties, &text[header], count - header);
+
+      if (!added) break;
+
+      if (added > 0) {
+        if (obj->current.active && obj->current.properties.interruptible &&
+            (obj->current.properties.priority <= properties.priority)) {
+          stopSpeechInputAlarm(obj);
+          obj->current.active = 0;
+          options |= SAY_OPT_MUTE_FIRST;
+        }
+      }
+    }
+
+    text = next;
+  }
+
+  sayNextSpeechInputUtterance(obj, options);
+  return text - (const char *)buffer;
+}
+
+static int
+isSpeechInputQueueFull (SpeechInputObject *obj) {
+  return getQueueSize(obj->utterances) >= SPEECH_INPUT_QUEUE_LIMIT;
+}
+
+static int
+hasHeldSpeechInputLine (SpeechInputObject *obj, int final) {
+  if (!obj->held.length) return 0;
+  if (final) return 1;
+  return !!memchr(obj->held.buffer, '\n', obj->held.length);
+}
+
+static int
+holdSpeechInput (SpeechInputObject *obj, const unsigned char *buffer, size_t length) {
+  if (length) {
+    size_t newLength = obj->held.length + length;
+    unsigned char *newBuffer = realloc(obj->held.buffer, newLength);
+
+    if (!newBuffer) {
+      logMallocError();
+      return 0;
+    }
+
+    memcpy(&newBuffer[obj->held.length], buffer, length);
+    obj->held.buffer = newBuffer;
+    obj->held.length = newLength;
+  }
+
+  return 1;
+}
+
+static void processHeldSpeechInput (SpeechInputObject *obj, int final);
+
+ASYNC_ALARM_CALLBACK(handleSpeechInputFragmentAlarm) {
+  SpeechInputObject *obj = parameters->data;
+
+  asyncDiscardHandle(obj->held.alarm);
+  obj->held.alarm = NULL;
+
+  logMessage(LOG_DEBUG, "speech input line not terminated");
+  processHeldSpeechInput(obj, 1);
+}
+
+static void
+stopSpeechInputFragmentAlarm (SpeechInputObject *obj) {
+  if (obj->held.alarm) {
+    asyncCancelRequest(obj->held.alarm);
+    obj->held.alarm = NULL;
+  }
+}
+
+static void
+updateHeldSpeechInput (SpeechInputObject *obj) {
+  if (obj->held.length && isSpeechInputQueueFull(obj)) {
+    /* complete lines are waiting for room in the queue */
+    stopSpeechInputFragmentAlarm(obj);
+
+    if (!obj->held.suspended) {
+      logMessage(LOG_DEBUG, "speech input held: %"PRIsize " bytes", obj->held.length);
+      suspendNamedPipeInput(obj->pipe);
+      obj->held.suspended = 1;
+    }
+  } else {
+    if (obj->held.suspended) {
+      resumeNamedPipeInput(obj->pipe);
+      obj->held.suspended = 0;
+    }
+
+    if (!obj->held.length) {
+      stopSpeechInputFragmentAlarm(obj);
+    } else if (!obj->held.alarm) {
+      asyncSetAlarmIn(&obj->held.alarm, SPEECH_INPUT_FRAGMENT_TIME,
+                      handleSpeechInputFragmentAlarm, obj);
+    }
+  }
+}
+
+static void
+processHeldSpeechInput (SpeechInputObject *obj, int final) {
+  /* speaking an utterance while the held input is being processed makes
+   * room in the queue, but the loop below takes care of that
+   */
+  if (obj->held.busy) return;
+  obj->held.busy = 1;
+
+  while (hasHeldSpeechInputLine(obj, final)) {
+    size_t count = processSpeechInput(obj, obj->held.buffer, obj->held.length, final);
+
+    if (count) {
+      memmove(obj->held.buffer, &obj->held.buffer[count], (obj->held.length -= count));
+    } else if (isSpeechInputQueueFull(obj)) {
+      break;
+    }
+  }
+
+  obj->held.busy = 0;
+  updateHeldSpeechInput(obj);
+}
+
+static void
+sayNextSpeechInputUtterance (SpeechInputObject *obj, SayOptions options) {
+  if (!obj->current.active) {
+    SpeechInputUtterance *utterance = dequeueItem(obj->utterances);
+
+    if (utterance) {
+      int duration = getTextLength(utterance->text) * SPEECH_INPUT_CHARACTER_TIME;
+
+      if (duration < SPEECH_INPUT_MINIMUM_TIME) duration = SPEECH_INPUT_MINIMUM_TIME;
+
+      obj->current.properties = utterance->properties;
+      obj->current.active = 1;
+      asyncSetAlarmIn(&obj->current.alarm, duration, handleSpeechInputAlarm, obj);
+
+      sayString(&spk, utterance->text, options);
+      deallocateSpeechInputUtterance(utterance, NULL);
+
+      if (!isSpeechInputQueueFull(obj)) {
+        processHeldSpeechInput(obj, 0);
+      }
+    }
+  }
+}
+
 static
 NAMED_PIPE_INPUT_CALLBACK(handleSpeechInput) {
-//SpeechInputObject *obj = parameters->data;
+  SpeechInputObject *obj = parameters->data;
 
-  const unsigned char *buffer = parameters->buffer;
-  size_t length = parameters->length;
-  char string[length + 1];
-
-  memcpy(string, buffer, length);
-  string[length] = 0;
-  sayString(&spk, string, 0);
+  if (!holdSpeechInput(obj, parameters->buffer, parameters->length)) return 0;
+  processHeldSpeechInput(obj, parameters->end);
+  return parameters->length;
+}
 
-  return length;
+void
+setSpeechInputFinished (SpeechInputObject *obj) {
+  if (obj->current.active) {
+    stopSpeechInputAlarm(obj);
+    obj->current.active = 0;
+    sayNextSpeechInputUtterance(obj, 0);
+  }
 }
 
 SpeechInputObject *
@@ -52,9 +385,20 @@ newSpeechInputObject (const char *name) {
 
   if ((obj = malloc(sizeof(*obj)))) {
     memset(obj, 0, sizeof(*obj));
+    obj->current.alarm = NULL;
+    obj->current.active = 0;
+    obj->held.buffer = NULL;
+    obj->held.length = 0;
+    obj->held.alarm = NULL;
+    obj->held.busy = 0;
+    obj->held.suspended = 0;
+
+    if ((obj->utterances = newQueue(deallocateSpeechInputUtterance, compareSpeechInputUtterances))) {
+      if ((obj->pipe = newNamedPipeObject(name, handleSpeechInput, obj))) {
+        return obj;
+      }
 
-    if ((obj->pipe = newNamedPipeObject(name, handleSpeechInput, obj))) {
-      return obj;
+      deallocateQueue(obj->utterances);
     }
 
     free(obj);
@@ -68,6 +412,10 @@ newSpeechInputObject (const char *name) {
 void
 destroySpeechInputObject (SpeechInputObject *obj) {
   if (obj->pipe) destroyNamedPipeObject(obj->pipe);
+  stopSpeechInputAlarm(obj);
+  stopSpeechInputFragmentAlarm(obj);
+  if (obj->utterances) deallocateQueue(obj->utterances);
+  if (obj->held.buffer) free(obj->held.buffer);
   free(obj);
 }
 #endif /* ENABLE_SPEECH_SUPPORT */
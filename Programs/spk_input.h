@@ -28,6 +28,7 @@ typedef struct SpeechInputObjectStruct SpeechInputObject;
 
 extern SpeechInputObject *newSpeechInputObject (const char *name);
 extern void destroySpeechInputObject (SpeechInputObject *obj);
+extern void setSpeechInputFinished (SpeechInputObject *obj);
 #endif /* ENABLE_SPEECH_SUPPORT */
 
 #ifdef __cplusplus
@@ -709,6 +709,12 @@ const unsigned char linuxKeyMapCount = ARRAY_COUNT(linuxKeyMapDescriptors);
 struct UinputObjectStruct {
   int fileDescriptor;
   BITMASK(pressedKeys, KEY_MAX+1, char);
+
+  struct {
+    struct input_event events[0X40];
+    unsigned int count;
+    unsigned isActive:1;
+  } batch;
 };
 #endif /* HAVE_LINUX_UINPUT_H */
 
@@ -920,6 +926,7 @@ newUinputObject (const char *name) {
 void
 destroyUinputObject (UinputObject *uinput) {
 #ifdef HAVE_LINUX_UINPUT_H
+  endUinputBatch(uinput);
   releasePressedKeys(uinput);
   close(uinput->fileDescriptor);
   free(uinput);
@@ -951,24 +958,60 @@ enableUinputEventType (UinputObject *uinput, int type) {
   return 0;
 }
 
+#ifdef HAVE_LINUX_UINPUT_H
+static int
+flushInputEvents (UinputObject *uinput) {
+  size_t size = uinput->batch.count * sizeof(uinput->batch.events[0]);
+
+  uinput->batch.count = 0;
+  if (!size) return 1;
+
+  if (write(uinput->fileDescriptor, uinput->batch.events, size) != -1) return 1;
+  logSystemError("write(struct input_event)");
+  return 0;
+}
+#endif /* HAVE_LINUX_UINPUT_H */
+
 int
 writeInputEvent (UinputObject *uinput, uint16_t type, uint16_t code, int32_t value) {
 #ifdef HAVE_LINUX_UINPUT_H
-  struct input_event event;
+  struct input_event *event;
 
-  memset(&event, 0, sizeof(event));
-  gettimeofday(&event.time, NULL);
-  event.type = type;
-  event.code = code;
-  event.value = value;
+  if (uinput->batch.count == ARRAY_COUNT(uinput->batch.events)) {
+    if (!flushInputEvents(uinput)) return 0;
+  }
 
-  if (write(uinput->fileDescriptor, &event, sizeof(event)) != -1) return 1;
-  logSystemError("write(struct input_event)");
+  event = &uinput->batch.events[uinput->batch.count++];
+  memset(event, 0, sizeof(*event));
+  gettimeofday(&event->time, NULL);
+  event->type = type;
+  event->code = code;
+  event->value = value;
+
+  if (uinput->batch.isActive) return 1;
+  return flushInputEvents(uinput);
 #endif /* HAVE_LINUX_UINPUT_H */
 
   return 0;
 }
 
+void
+beginUinputBatch (UinputObject *uinput) {
+#ifdef HAVE_LINUX_UINPUT_H
+  uinput->batch.isActive = 1;
+#endif /* HAVE_LINUX_UINPUT_H */
+}
+
+int
+endUinputBatch (UinputObject *uinput) {
+#ifdef HAVE_LINUX_UINPUT_H
+  uinput->batch.isActive = 0;
+  return flushInputEvents(uinput);
+#endif /* HAVE_LINUX_UINPUT_H */
+
+  return 1;
+}
+
 static int
 writeSynReport (UinputObject *uinput) {
   return writeInputEvent(uinput, EV_SYN, SYN_REPORT, 0);
@@ -28,6 +28,7 @@
 #include "update.h"
 #include "async_alarm.h"
 #include "timing.h"
+#include "latency.h"
 #include "unicode.h"
 #include "charset.h"
 #include "ttb.h"
@@ -47,6 +48,42 @@
 static int oldwinx;
 static int oldwiny;
 
+typedef enum {
+  UPDATE_STAGE_REFRESH,
+  UPDATE_STAGE_SESSION,
+  UPDATE_STAGE_FLUSH,
+  UPDATE_STAGE_TRACK,
+  UPDATE_STAGE_AUTOSPEAK,
+  UPDATE_STAGE_TRANSLATE,
+  UPDATE_STAGE_CONTRACT, /* nested within (and also counted by) translate */
+  UPDATE_STAGE_STATUS,
+  UPDATE_STAGE_WRITE,
+  UPDATE_STAGE_TOTAL,
+  UPDATE_STAGE_COUNT /* must be last */
+} UpdateStage;
+
+static LatencyHistogram updateLatencies[UPDATE_STAGE_COUNT] = {
+  [UPDATE_STAGE_REFRESH] = LATENCY_HISTOGRAM_INITIALIZER("refresh"),
+  [UPDATE_STAGE_SESSION] = LATENCY_HISTOGRAM_INITIALIZER("session"),
+  [UPDATE_STAGE_FLUSH] = LATENCY_HISTOGRAM_INITIALIZER("flush"),
+  [UPDATE_STAGE_TRACK] = LATENCY_HISTOGRAM_INITIALIZER("track"),
+  [UPDATE_STAGE_AUTOSPEAK] = LATENCY_HISTOGRAM_INITIALIZER("autospeak"),
+  [UPDATE_STAGE_TRANSLATE] = LATENCY_HISTOGRAM_INITIALIZER("translate"),
+  [UPDATE_STAGE_CONTRACT] = LATENCY_HISTOGRAM_INITIALIZER("contract (within translate)"),
+  [UPDATE_STAGE_STATUS] = LATENCY_HISTOGRAM_INITIALIZER("status"),
+  [UPDATE_STAGE_WRITE] = LATENCY_HISTOGRAM_INITIALIZER("write"),
+  [UPDATE_STAGE_TOTAL] = LATENCY_HISTOGRAM_INITIALIZER("update")
+};
+
+/* Adds the time since *start to a stage and then makes the current time
+ * the start of the next stage, so that consecutive stages need only one
+ * clock reading each.
+ */
+static void
+endUpdateStage (UpdateStage stage, TimeValue *start) {
+  addLatencySince(&updateLatencies[stage], start);
+}
+
 static int
 checkScreenPointer (void) {
   int moved = 0;
@@ -579,15 +616,519 @@ writeBrailleWindow (BrailleDisplay *brl, const wchar_t *text) {
   return braille->writeWindow(brl, text);
 }
 
+static BlinkDescriptor *const renderedBlinkDescriptors[] = {
+  &screenCursorBlinkDescriptor,
+  &attributesUnderlineBlinkDescriptor,
+  &uppercaseLettersBlinkDescriptor,
+  &speechCursorBlinkDescriptor
+};
+
+/* The part of the screen that the braille window shows, read once per
+ * update, along with everything else that the rendering of the window
+ * depends on. The screen part is also what the poll interval adapts to.
+ * Snapshots are compared byte for byte so their structures are always
+ * cleared before being filled in.
+ */
+typedef struct {
+  struct {
+    int number;
+    int columns;
+    int rows;
+    int cursorColumn;
+    int cursorRow;
+    int windowColumn;
+    int windowRow;
+    int infoMode;
+
+    int isReadable;
+    unsigned int width;
+    unsigned int height;
+  } screen;
+
+  struct {
+    Preferences preferences;
+    int hasCursor;
+    int speechColumn;
+    int speechRow;
+    int displayMode;
+    int hideScreenCursor;
+    int hideBrailleCursor;
+
+    unsigned int textColumns;
+    unsigned int textRows;
+    unsigned int textStart;
+    unsigned int textCount;
+
+    int isContracting;
+    int contractedTrack;
+    unsigned int blinkVisibility;
+  } render;
+
+  ScreenCharacter *characters;
+  unsigned int size;
+} WindowSnapshot;
+
+static WindowSnapshot windowSnapshot;
+
+static unsigned int
+getWindowSnapshotCount (const WindowSnapshot *snapshot) {
+  return snapshot->screen.width * snapshot->screen.height;
+}
+
+static int
+allocateWindowSnapshot (WindowSnapshot *snapshot, unsigned int count) {
+  if (count > snapshot->size) {
+    ScreenCharacter *characters;
+
+    if (!(characters = realloc(snapshot->characters, ARRAY_SIZE(characters, count)))) {
+      logMallocError();
+      return 0;
+    }
+
+    snapshot->characters = characters;
+    snapshot->size = count;
+  }
+
+  return 1;
+}
+
+static void
+takeWindowSnapshot (WindowSnapshot *snapshot) {
+  int contracting = 0;
+
+#ifdef ENABLE_CONTRACTED_BRAILLE
+  contracting = isContracting();
+#endif /* ENABLE_CONTRACTED_BRAILLE */
+
+  memset(&snapshot->screen, 0, sizeof(snapshot->screen));
+  snapshot->screen.number = scr.number;
+  snapshot->screen.columns = scr.cols;
+  snapshot->screen.rows = scr.rows;
+  snapshot->screen.cursorColumn = scr.posx;
+  snapshot->screen.cursorRow = scr.posy;
+  snapshot->screen.windowColumn = ses->winx;
+  snapshot->screen.windowRow = ses->winy;
+  snapshot->screen.infoMode = infoMode;
+
+  if ((ses->winx < scr.cols) && (ses->winy < scr.rows)) {
+    unsigned int width;
+    unsigned int height;
+
+    if (contracting) {
+      width = scr.cols - ses->winx;
+      height = 1;
+    } else {
+      width = MIN(textCount, scr.cols-ses->winx);
+      height = MIN(brl.textRows, scr.rows-ses->winy);
+    }
+
+    if (allocateWindowSnapshot(snapshot, (width * height))) {
+      if (readScreen(ses->winx, ses->winy, width, height, snapshot->characters)) {
+        snapshot->screen.isReadable = 1;
+        snapshot->screen.width = width;
+        snapshot->screen.height = height;
+      }
+    }
+  }
+
+  memset(&snapshot->render, 0, sizeof(snapshot->render));
+  memcpy(&snapshot->render.preferences, &prefs, sizeof(prefs));
+  snapshot->render.hasCursor = scr.cursor;
+  snapshot->render.speechColumn = ses->spkx;
+  snapshot->render.speechRow = ses->spky;
+  snapshot->render.displayMode = ses->displayMode;
+  snapshot->render.hideScreenCursor = ses->hideScreenCursor;
+  snapshot->render.hideBrailleCursor = brl.hideCursor;
+
+  snapshot->render.textColumns = brl.textColumns;
+  snapshot->render.textRows = brl.textRows;
+  snapshot->render.textStart = textStart;
+  snapshot->render.textCount = textCount;
+
+  snapshot->render.isContracting = contracting;
+#ifdef ENABLE_CONTRACTED_BRAILLE
+  snapshot->render.contractedTrack = contractedTrack;
+#endif /* ENABLE_CONTRACTED_BRAILLE */
+
+  for (unsigned int index=0; index<ARRAY_COUNT(renderedBlinkDescriptors); index+=1) {
+    if (isBlinkVisible(renderedBlinkDescriptors[index])) {
+      snapshot->render.blinkVisibility |= 1 << index;
+    }
+  }
+}
+
+static int
+copyWindowSnapshot (WindowSnapshot *to, const WindowSnapshot *from) {
+  unsigned int count = getWindowSnapshotCount(from);
+
+  if (!allocateWindowSnapshot(to, count)) return 0;
+  memcpy(&to->screen, &from->screen, sizeof(to->screen));
+  memcpy(&to->render, &from->render, sizeof(to->render));
+  memcpy(to->characters, from->characters, ARRAY_SIZE(to->characters, count));
+  return 1;
+}
+
+static int
+isSameWindowScreen (const WindowSnapshot *snapshot1, const WindowSnapshot *snapshot2) {
+  if (memcmp(&snapshot1->screen, &snapshot2->screen, sizeof(snapshot1->screen)) != 0) return 0;
+
+  return memcmp(snapshot1->characters, snapshot2->characters,
+                ARRAY_SIZE(snapshot1->characters, getWindowSnapshotCount(snapshot1))) == 0;
+}
+
+static int
+isSameWindowRendering (const WindowSnapshot *snapshot1, const WindowSnapshot *snapshot2) {
+  if (memcmp(&snapshot1->render, &snapshot2->render, sizeof(snapshot1->render)) != 0) return 0;
+  return isSameWindowScreen(snapshot1, snapshot2);
+}
+
+/* The translated braille window (the text cells along with the cursor)
+ * from the last update, and a snapshot of everything it was derived from,
+ * so that it needn't be rebuilt while nothing it depends on changes.
+ * The status cells aren't included since some of them (e.g. the time)
+ * change on their own.
+ */
+static struct {
+  WindowSnapshot snapshot;
+
+  unsigned char *cells;
+  wchar_t *text;
+  unsigned int size;
+  unsigned isValid:1;
+
+  int cursor;
+  int column;
+  unsigned int blinkRequirements;
+
+#ifdef ENABLE_CONTRACTED_BRAILLE
+  int isContracted;
+  int contractedStart;
+  int contractedLength;
+  int contractedTrack;
+#endif /* ENABLE_CONTRACTED_BRAILLE */
+
+  unsigned int hits;
+  unsigned int misses;
+} renderCache;
+
+void
+resetRenderCache (void) {
+  renderCache.isValid = 0;
+}
+
+static int
+allocateRenderCache (unsigned int size) {
+  if (size != renderCache.size) {
+    unsigned char *cells;
+    wchar_t *text;
+
+    renderCache.isValid = 0;
+
+    if (!(cells = realloc(renderCache.cells, ARRAY_SIZE(cells, size)))) {
+      logMallocError();
+      return 0;
+    }
+
+    renderCache.cells = cells;
+
+    if (!(text = realloc(renderCache.text, ARRAY_SIZE(text, size)))) {
+      logMallocError();
+      return 0;
+    }
+
+    renderCache.text = text;
+    renderCache.size = size;
+  }
+
+  return 1;
+}
+
+static int
+restoreRenderedWindow (const WindowSnapshot *snapshot, wchar_t *text) {
+  if (!renderCache.isValid) return 0;
+  if (!isSameWindowRendering(snapshot, &renderCache.snapshot)) return 0;
+
+  memcpy(brl.buffer, renderCache.cells, ARRAY_SIZE(brl.buffer, renderCache.size));
+  wmemcpy(text, renderCache.text, renderCache.size);
+  brl.cursor = renderCache.cursor;
+  ses->winx = renderCache.column;
+
+#ifdef ENABLE_CONTRACTED_BRAILLE
+  isContracted = renderCache.isContracted;
+  contractedStart = renderCache.contractedStart;
+  contractedLength = renderCache.contractedLength;
+  contractedTrack = renderCache.contractedTrack;
+#endif /* ENABLE_CONTRACTED_BRAILLE */
+
+  for (unsigned int index=0; index<ARRAY_COUNT(renderedBlinkDescriptors); index+=1) {
+    if (renderCache.blinkRequirements & (1 << index)) {
+      requireBlinkDescriptor(renderedBlinkDescriptors[index]);
+    }
+  }
+
+  return 1;
+}
+
+static void
+saveRenderedWindow (const wchar_t *text) {
+  memcpy(renderCache.cells, brl.buffer, ARRAY_SIZE(brl.buffer, renderCache.size));
+  wmemcpy(renderCache.text, text, renderCache.size);
+  renderCache.cursor = brl.cursor;
+  renderCache.column = ses->winx;
+
+#ifdef ENABLE_CONTRACTED_BRAILLE
+  renderCache.isContracted = isContracted;
+  renderCache.contractedStart = contractedStart;
+  renderCache.contractedLength = contractedLength;
+  renderCache.contractedTrack = contractedTrack;
+#endif /* ENABLE_CONTRACTED_BRAILLE */
+
+  renderCache.blinkRequirements = 0;
+
+  for (unsigned int index=0; index<ARRAY_COUNT(renderedBlinkDescriptors); index+=1) {
+    if (isBlinkDescriptorRequired(renderedBlinkDescriptors[index])) {
+      renderCache.blinkRequirements |= 1 << index;
+    }
+  }
+
+  renderCache.isValid = 1;
+}
+
+static void
+translateBrailleWindow (wchar_t *textBuffer, WindowSnapshot *snapshot) {
+  const unsigned int textLength = textCount * brl.textRows;
+
+#ifdef ENABLE_CONTRACTED_BRAILLE
+  isContracted = 0;
+
+  if (isContracting()) {
+    while (snapshot->screen.isReadable) {
+      const ScreenCharacter *inputCharacters = snapshot->characters;
+      int inputLength = snapshot->screen.width;
+      wchar_t inputText[inputLength];
+
+      int outputLength = textLength;
+      unsigned char outputBuffer[outputLength];
+
+      {
+        int i;
+        for (i=0; i<inputLength; ++i) {
+          inputText[i] = inputCharacters[i].text;
+        }
+      }
+
+      {
+        TimeValue contractStart;
+
+        getMonotonicTime(&contractStart);
+        contractText(contractionTable,
+                     inputText, &inputLength,
+                     outputBuffer, &outputLength,
+                     contractedOffsets, getContractedCursor());
+        endUpdateStage(UPDATE_STAGE_CONTRACT, &contractStart);
+      }
+
+      {
+        int inputEnd = inputLength;
+
+        if (contractedTrack) {
+          if (outputLength == textLength) {
+            int inputIndex = inputEnd;
+            while (inputIndex) {
+              int offset = contractedOffsets[--inputIndex];
+              if (offset != CTB_NO_OFFSET) {
+                if (offset != outputLength) break;
+                inputEnd = inputIndex;
+              }
+            }
+          }
+
+          if (scr.posx >= (ses->winx + inputEnd)) {
+            int offset = 0;
+            int length = snapshot->screen.width;
+            int onspace = 0;
+
+            while (offset < length) {
+              if ((iswspace(inputCharacters[offset].text) != 0) != onspace) {
+                if (onspace) break;
+                onspace = 1;
+              }
+              ++offset;
+            }
+
+            if ((offset += ses->winx) > scr.posx) {
+              ses->winx = (ses->winx + scr.posx) / 2;
+            } else {
+              ses->winx = offset;
+            }
+
+            takeWindowSnapshot(snapshot);
+            continue;
+          }
+        }
+      }
+
+      contractedStart = ses->winx;
+      contractedLength = inputLength;
+      contractedTrack = 0;
+      isContracted = 1;
+
+      if (ses->displayMode || prefs.showAttributes) {
+        int inputOffset;
+        int outputOffset = 0;
+        unsigned char attributes = 0;
+        unsigned char attributesBuffer[outputLength];
+
+        for (inputOffset=0; inputOffset<contractedLength; ++inputOffset) {
+          int offset = contractedOffsets[inputOffset];
+
+          if (offset != CTB_NO_OFFSET) {
+            while (outputOffset < offset) attributesBuffer[outputOffset++] = attributes;
+            attributes = 0;
+          }
+
+          attributes |= inputCharacters[inputOffset].attributes;
+        }
+
+        while (outputOffset < outputLength) attributesBuffer[outputOffset++] = attributes;
+
+        if (ses->displayMode) {
+          for (outputOffset=0; outputOffset<outputLength; ++outputOffset) {
+            outputBuffer[outputOffset] = convertAttributesToDots(attributesTable, attributesBuffer[outputOffset]);
+          }
+        } else {
+          unsigned int i;
+
+          for (i=0; i<outputLength; i+=1) {
+            overlayAttributesUnderline(&outputBuffer[i], attributesBuffer[i]);
+          }
+        }
+      }
+
+      fillDotsRegion(textBuffer, brl.buffer,
+                     textStart, textCount, brl.textColumns, brl.textRows,
+                     outputBuffer, outputLength);
+      break;
+    }
+  }
+
+  if (!isContracted)
+#endif /* ENABLE_CONTRACTED_BRAILLE */
+  {
+    ScreenCharacter characters[textLength];
+
+    {
+      /* The snapshot is a rectangular piece of the screen which is narrower
+       * and/or shorter than the window when the display is in an off-right
+       * and/or off-bottom position, so we'll blank the cells beyond it.
+       */
+      unsigned int width = MIN(snapshot->screen.width, textCount);
+      unsigned int height = snapshot->screen.height;
+      unsigned int row;
+
+      for (row=0; row<brl.textRows; row+=1) {
+        ScreenCharacter *target = &characters[row * textCount];
+        unsigned int count = 0;
+
+        if (row < height) {
+          memcpy(target, &snapshot->characters[row * snapshot->screen.width],
+                 ARRAY_SIZE(target, width));
+          count = width;
+        }
+
+        clearScreenCharacters(target+count, textCount-count);
+      }
+    }
+
+    /* convert to dots using the current translation table */
+    if (ses->displayMode) {
+      int row;
+
+      for (row=0; row<brl.textRows; row+=1) {
+        const ScreenCharacter *source = &characters[row * textCount];
+        unsigned int start = (row * brl.textColumns) + textStart;
+        unsigned char *target = &brl.buffer[start];
+        wchar_t *text = &textBuffer[start];
+        int column;
+
+        for (column=0; column<textCount; column+=1) {
+          text[column] = UNICODE_BRAILLE_ROW | (target[column] = convertAttributesToDots(attributesTable, source[column].attributes));
+        }
+      }
+    } else {
+      unsigned int row;
+
+      for (row=0; row<brl.textRows; row+=1) {
+        const ScreenCharacter *source = &characters[row * textCount];
+        unsigned int start = (row * brl.textColumns) + textStart;
+        unsigned char *target = &brl.buffer[start];
+        wchar_t *text = &textBuffer[start];
+        unsigned int column;
+
+        for (column=0; column<textCount; column+=1) {
+          const ScreenCharacter *character = &source[column];
+          unsigned char *dots = &target[column];
+
+          *dots = convertCharacterToDots(textTable, character->text);
+
+          if (iswupper(character->text)) {
+            BlinkDescriptor *blink = &uppercaseLettersBlinkDescriptor;
+
+            requireBlinkDescriptor(blink);
+            if (!isBlinkVisible(blink)) *dots = 0;
+          }
+
+          if (prefs.textStyle) *dots &= ~(BRL_DOT_7 | BRL_DOT_8);
+          if (prefs.showAttributes) overlayAttributesUnderline(dots, character->attributes);
+
+          text[column] = character->text;
+        }
+      }
+    }
+  }
+
+  if ((brl.cursor = getScreenCursorPosition(scr.posx, scr.posy)) != BRL_NO_CURSOR) {
+    if (showScreenCursor()) {
+      BlinkDescriptor *blink = &screenCursorBlinkDescriptor;
+
+      requireBlinkDescriptor(blink);
+      if (isBlinkVisible(blink)) brl.buffer[brl.cursor] |= getScreenCursorDots();
+    }
+  }
+
+  if (prefs.showSpeechCursor) {
+    int position = getScreenCursorPosition(ses->spkx, ses->spky);
+
+    if (position != BRL_NO_CURSOR) {
+      if (position != brl.cursor) {
+        BlinkDescriptor *blink = &speechCursorBlinkDescriptor;
+
+        requireBlinkDescriptor(blink);
+        if (isBlinkVisible(blink)) brl.buffer[position] |= cursorStyles[prefs.speechCursorStyle];
+      }
+    }
+  }
+}
+
 static void
 doUpdate (void) {
   int screenPointerMoved = 0;
+  TimeValue updateStart;
+  TimeValue stageStart;
 
   logMessage(LOG_CATEGORY(UPDATE_EVENTS), "starting");
+  getMonotonicTime(&updateStart);
   unrequireAllBlinkDescriptors();
+
+  stageStart = updateStart;
   refreshScreen();
+  endUpdateStage(UPDATE_STAGE_REFRESH, &stageStart);
+
   updateSessionAttributes();
+  endUpdateStage(UPDATE_STAGE_SESSION, &stageStart);
+
   api.flush();
+  endUpdateStage(UPDATE_STAGE_FLUSH, &stageStart);
 
   if (scr.unreadable) {
     logMessage(LOG_CATEGORY(UPDATE_EVENTS), "screen unreadable: %s", scr.unreadable);
@@ -621,6 +1162,7 @@ doUpdate (void) {
     }
   }
 
+  getMonotonicTime(&stageStart);
   if (ses->trackScreenCursor) {
 #ifdef ENABLE_SPEECH_SUPPORT
     if (!spk.track.isActive)
@@ -657,6 +1199,8 @@ doUpdate (void) {
     }
   }
 
+  endUpdateStage(UPDATE_STAGE_TRACK, &stageStart);
+
 #ifdef ENABLE_SPEECH_SUPPORT
   if (spk.canAutospeak) {
     int isAutospeaking = isAutospeakActive();
@@ -668,6 +1212,7 @@ doUpdate (void) {
     }
 
     wasAutospeaking = isAutospeaking;
+    endUpdateStage(UPDATE_STAGE_AUTOSPEAK, &stageStart);
   }
 #endif /* ENABLE_SPEECH_SUPPORT */
 
@@ -693,6 +1238,9 @@ doUpdate (void) {
     oldwiny = ses->winy;
   }
 
+  getMonotonicTime(&stageStart);
+  takeWindowSnapshot(&windowSnapshot);
+
   if (!brl.isOffline && canBraille()) {
     api.claimDriver();
 
@@ -700,215 +1248,31 @@ doUpdate (void) {
       if (!showInfo()) brl.hasFailed = 1;
     } else {
       const unsigned int windowLength = brl.textColumns * brl.textRows;
-      const unsigned int textLength = textCount * brl.textRows;
       wchar_t textBuffer[windowLength];
+      int isCacheable;
 
       memset(brl.buffer, 0, windowLength);
       wmemset(textBuffer, WC_C(' '), windowLength);
 
-#ifdef ENABLE_CONTRACTED_BRAILLE
-      isContracted = 0;
+      isCacheable = windowSnapshot.screen.isReadable && allocateRenderCache(windowLength);
 
-      if (isContracting()) {
-        while (1) {
-          int inputLength = scr.cols - ses->winx;
-          ScreenCharacter inputCharacters[inputLength];
-          wchar_t inputText[inputLength];
-
-          int outputLength = textLength;
-          unsigned char outputBuffer[outputLength];
-
-          readScreen(ses->winx, ses->winy, inputLength, 1, inputCharacters);
-
-          {
-            int i;
-            for (i=0; i<inputLength; ++i) {
-              inputText[i] = inputCharacters[i].text;
-            }
-          }
-
-          contractText(contractionTable,
-                       inputText, &inputLength,
-                       outputBuffer, &outputLength,
-                       contractedOffsets, getContractedCursor());
-
-          {
-            int inputEnd = inputLength;
-
-            if (contractedTrack) {
-              if (outputLength == textLength) {
-                int inputIndex = inputEnd;
-                while (inputIndex) {
-                  int offset = contractedOffsets[--inputIndex];
-                  if (offset != CTB_NO_OFFSET) {
-                    if (offset != outputLength) break;
-                    inputEnd = inputIndex;
-                  }
-                }
-              }
-
-              if (scr.posx >= (ses->winx + inputEnd)) {
-                int offset = 0;
-                int length = scr.cols - ses->winx;
-                int onspace = 0;
-
-                while (offset < length) {
-                  if ((iswspace(inputCharacters[offset].text) != 0) != onspace) {
-                    if (onspace) break;
-                    onspace = 1;
-                  }
-                  ++offset;
-                }
-
-                if ((offset += ses->winx) > scr.posx) {
-                  ses->winx = (ses->winx + scr.posx) / 2;
-                } else {
-                  ses->winx = offset;
-                }
-
-                continue;
-              }
-            }
-          }
-
-          contractedStart = ses->winx;
-          contractedLength = inputLength;
-          contractedTrack = 0;
-          isContracted = 1;
-
-          if (ses->displayMode || prefs.showAttributes) {
-            int inputOffset;
-            int outputOffset = 0;
-            unsigned char attributes = 0;
-            unsigned char attributesBuffer[outputLength];
-
-            for (inputOffset=0; inputOffset<contractedLength; ++inputOffset) {
-              int offset = contractedOffsets[inputOffset];
-
-              if (offset != CTB_NO_OFFSET) {
-                while (outputOffset < offset) attributesBuffer[outputOffset++] = attributes;
-                attributes = 0;
-              }
-
-              attributes |= inputCharacters[inputOffset].attributes;
-            }
-
-            while (outputOffset < outputLength) attributesBuffer[outputOffset++] = attributes;
-
-            if (ses->displayMode) {
-              for (outputOffset=0; outputOffset<outputLength; ++outputOffset) {
-                outputBuffer[outputOffset] = convertAttributesToDots(attributesTable, attributesBuffer[outputOffset]);
-              }
-            } else {
-              unsigned int i;
-
-              for (i=0; i<outputLength; i+=1) {
-                overlayAttributesUnderline(&outputBuffer[i], attributesBuffer[i]);
-              }
-            }
-          }
-
-          fillDotsRegion(textBuffer, brl.buffer,
-                         textStart, textCount, brl.textColumns, brl.textRows,
-                         outputBuffer, outputLength);
-          break;
-        }
-      }
-
-      if (!isContracted)
-#endif /* ENABLE_CONTRACTED_BRAILLE */
-      {
-        int windowColumns = MIN(textCount, scr.cols-ses->winx);
-        ScreenCharacter characters[textLength];
-
-        readScreen(ses->winx, ses->winy, windowColumns, brl.textRows, characters);
-        if (windowColumns < textCount) {
-          /* We got a rectangular piece of text with readScreen but the display
-           * is in an off-right position with some cells at the end blank
-           * so we'll insert these cells and blank them.
-           */
-          int i;
-
-          for (i=brl.textRows-1; i>0; i--) {
-            memmove(characters + (i * textCount),
-                    characters + (i * windowColumns),
-                    windowColumns * sizeof(*characters));
-          }
-
-          for (i=0; i<brl.textRows; i++) {
-            clearScreenCharacters(characters + (i * textCount) + windowColumns,
-                                  textCount-windowColumns);
-          }
-        }
-
-        /* convert to dots using the current translation table */
-        if (ses->displayMode) {
-          int row;
+      if (isCacheable && restoreRenderedWindow(&windowSnapshot, textBuffer)) {
+        renderCache.hits += 1;
+      } else {
+        renderCache.misses += 1;
 
-          for (row=0; row<brl.textRows; row+=1) {
-            const ScreenCharacter *source = &characters[row * textCount];
-            unsigned int start = (row * brl.textColumns) + textStart;
-            unsigned char *target = &brl.buffer[start];
-            wchar_t *text = &textBuffer[start];
-            int column;
+        /* the window may be moved (and hence reread) while contracting */
+        if (isCacheable) isCacheable = copyWindowSnapshot(&renderCache.snapshot, &windowSnapshot);
+        translateBrailleWindow(textBuffer, &windowSnapshot);
 
-            for (column=0; column<textCount; column+=1) {
-              text[column] = UNICODE_BRAILLE_ROW | (target[column] = convertAttributesToDots(attributesTable, source[column].attributes));
-            }
-          }
+        if (isCacheable) {
+          saveRenderedWindow(textBuffer);
         } else {
-          unsigned int row;
-
-          for (row=0; row<brl.textRows; row+=1) {
-            const ScreenCharacter *source = &characters[row * textCount];
-            unsigned int start = (row * brl.textColumns) + textStart;
-            unsigned char *target = &brl.buffer[start];
-            wchar_t *text = &textBuffer[start];
-            unsigned int column;
-
-            for (column=0; column<textCount; column+=1) {
-              const ScreenCharacter *character = &source[column];
-              unsigned char *dots = &target[column];
-
-              *dots = convertCharacterToDots(textTable, character->text);
-
-              if (iswupper(character->text)) {
-                BlinkDescriptor *blink = &uppercaseLettersBlinkDescriptor;
-
-                requireBlinkDescriptor(blink);
-                if (!isBlinkVisible(blink)) *dots = 0;
-              }
-
-              if (prefs.textStyle) *dots &= ~(BRL_DOT_7 | BRL_DOT_8);
-              if (prefs.showAttributes) overlayAttributesUnderline(dots, character->attributes);
-
-              text[column] = character->text;
-            }
-          }
-        }
-      }
-
-      if ((brl.cursor = getScreenCursorPosition(scr.posx, scr.posy)) != BRL_NO_CURSOR) {
-        if (showScreenCursor()) {
-          BlinkDescriptor *blink = &screenCursorBlinkDescriptor;
-
-          requireBlinkDescriptor(blink);
-          if (isBlinkVisible(blink)) brl.buffer[brl.cursor] |= getScreenCursorDots();
+          resetRenderCache();
         }
       }
 
-      if (prefs.showSpeechCursor) {
-        int position = getScreenCursorPosition(ses->spkx, ses->spky);
-
-        if (position != BRL_NO_CURSOR) {
-          if (position != brl.cursor) {
-            BlinkDescriptor *blink = &speechCursorBlinkDescriptor;
-
-            requireBlinkDescriptor(blink);
-            if (isBlinkVisible(blink)) brl.buffer[position] |= cursorStyles[prefs.speechCursorStyle];
-          }
-        }
-      }
+      endUpdateStage(UPDATE_STAGE_TRANSLATE, &stageStart);
 
       if (statusCount > 0) {
         const unsigned char *fields = prefs.statusFields;
@@ -926,13 +1290,17 @@ doUpdate (void) {
         fillStatusSeparator(textBuffer, brl.buffer);
       }
 
+      endUpdateStage(UPDATE_STAGE_STATUS, &stageStart);
+
       if (!(writeStatusCells() && writeBrailleWindow(&brl, textBuffer))) brl.hasFailed = 1;
+      endUpdateStage(UPDATE_STAGE_WRITE, &stageStart);
     }
 
     api.releaseDriver();
   }
 
   resetAllBlinkDescriptors();
+  endUpdateStage(UPDATE_STAGE_TOTAL, &updateStart);
   logMessage(LOG_CATEGORY(UPDATE_EVENTS), "finished");
 }
 
@@ -943,6 +1311,81 @@ static int updateSuspendCount;
 static TimeValue updateTime;
 static TimeValue earliestTime;
 
+static struct {
+  int interval;
+  unsigned int unchangedCount;
+  unsigned int changedCount;
+  unsigned interactive:1;
+
+  WindowSnapshot snapshot;
+  unsigned hasSnapshot:1;
+
+  unsigned int updates;
+  unsigned int changes;
+  unsigned int backoffs;
+} updatePoll;
+
+static int
+getUpdatePollInterval (void) {
+  /* The poll interval adapts to how often the screen actually changes:
+   * it drops to the minimum during bursts of changes or user input,
+   * returns to the normal interval after an isolated change, and doubles
+   * (up to the maximum) each time the screen stays unchanged for a while.
+   */
+  int changed = !updatePoll.hasSnapshot || !isSameWindowScreen(&windowSnapshot, &updatePoll.snapshot);
+  int interval = updatePoll.interval;
+
+  updatePoll.updates += 1;
+
+  if (changed || updatePoll.interactive) {
+    if (changed) updatePoll.hasSnapshot = copyWindowSnapshot(&updatePoll.snapshot, &windowSnapshot);
+    updatePoll.changes += 1;
+    updatePoll.unchangedCount = 0;
+
+    if (updatePoll.interactive || (++updatePoll.changedCount > 1)) {
+      interval = SCREEN_UPDATE_POLL_INTERVAL_MINIMUM;
+    } else {
+      interval = SCREEN_UPDATE_POLL_INTERVAL;
+    }
+
+    updatePoll.interactive = 0;
+  } else {
+    updatePoll.changedCount = 0;
+
+    if (++updatePoll.unchangedCount < SCREEN_UPDATE_POLL_IDLE_THRESHOLD) {
+      if (interval < SCREEN_UPDATE_POLL_INTERVAL) interval = SCREEN_UPDATE_POLL_INTERVAL;
+    } else {
+      updatePoll.unchangedCount = 0;
+
+      if (interval < SCREEN_UPDATE_POLL_INTERVAL_MAXIMUM) {
+        interval = MIN((interval * 2), SCREEN_UPDATE_POLL_INTERVAL_MAXIMUM);
+        updatePoll.backoffs += 1;
+      }
+    }
+
+#ifdef ENABLE_SPEECH_SUPPORT
+    /* autospeak depends on noticing changes promptly */
+    if (isAutospeakActive()) interval = MIN(interval, SCREEN_UPDATE_POLL_INTERVAL);
+#endif /* ENABLE_SPEECH_SUPPORT */
+  }
+
+  if (interval != updatePoll.interval) {
+    logMessage(LOG_CATEGORY(UPDATE_EVENTS), "poll interval: %d", interval);
+    updatePoll.interval = interval;
+  }
+
+  return interval;
+}
+
+static void
+resetUpdatePoll (void) {
+  updatePoll.interval = SCREEN_UPDATE_POLL_INTERVAL;
+  updatePoll.unchangedCount = 0;
+  updatePoll.changedCount = 0;
+  updatePoll.interactive = 0;
+  updatePoll.hasSnapshot = 0;
+}
+
 static void
 enforceEarliestTime (void) {
   if (compareTimeValues(&updateTime, &earliestTime) < 0) {
@@ -987,13 +1430,38 @@ scheduleUpdate (const char *reason) {
   scheduleUpdateIn(reason, 0);
 }
 
+void
+scheduleInteractiveUpdate (const char *reason) {
+  updatePoll.interactive = 1;
+  scheduleUpdate(reason);
+}
+
+void
+logUpdateStatistics (void) {
+  logMessage(LOG_NOTICE,
+             "update statistics: poll interval=%dms updates=%u changes=%u backoffs=%u",
+             updatePoll.interval, updatePoll.updates, updatePoll.changes, updatePoll.backoffs);
+
+  {
+    unsigned int renders = renderCache.hits + renderCache.misses;
+
+    logMessage(LOG_NOTICE,
+               "render cache: hits=%u misses=%u hit rate=%u%%",
+               renderCache.hits, renderCache.misses,
+               (renders? ((renderCache.hits * 100) / renders): 0));
+  }
+
+  for (unsigned int stage=0; stage<UPDATE_STAGE_COUNT; stage+=1) {
+    logLatencyHistogram(&updateLatencies[stage], LOG_NOTICE);
+  }
+}
+
 ASYNC_ALARM_CALLBACK(handleUpdateAlarm) {
   asyncDiscardHandle(updateAlarm);
   updateAlarm = NULL;
 
   suspendUpdates();
-  setUpdateTime((pollScreen()? SCREEN_UPDATE_POLL_INTERVAL: (SECS_PER_DAY * MSECS_PER_SEC)),
-                parameters->now, 0);
+  setUpdateTime((SECS_PER_DAY * MSECS_PER_SEC), parameters->now, 0);
 
   {
     int oldColumn = ses->winx;
@@ -1006,6 +1474,11 @@ ASYNC_ALARM_CALLBACK(handleUpdateAlarm) {
     }
   }
 
+  /* the poll interval depends on what this update saw, so it's applied
+   * afterward - without overriding anything the update scheduled sooner
+   */
+  if (pollScreen()) setUpdateTime(getUpdatePollInterval(), parameters->now, 1);
+
   setUpdateDelay(MAX((brl.writeDelay + 1), UPDATE_SCHEDULE_DELAY));
   brl.writeDelay = 0;
 
@@ -1034,6 +1507,7 @@ beginUpdates (void) {
 
   updateAlarm = NULL;
   updateSuspendCount = 0;
+  resetUpdatePoll();
 
   oldwinx = -1;
   oldwiny = -1;
@@ -30,6 +30,9 @@ extern void reportBrailleWindowMoved (void);
 
 extern void scheduleUpdate (const char *reason);
 extern void scheduleUpdateIn (const char *reason, int delay);
+extern void scheduleInteractiveUpdate (const char *reason);
+extern void logUpdateStatistics (void);
+extern void resetRenderCache (void);
 
 extern void beginUpdates (void);
 extern void suspendUpdates (void);
@@ -19,6 +19,7 @@
 #include "prologue.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include <fcntl.h>
@@ -1447,6 +1448,13 @@ struct UsbChooseChannelDataStruct {
   uint16_t vendorIdentifier;
   uint16_t productIdentifier;
   unsigned genericDevices:1;
+
+  struct {
+    const char **array;
+    unsigned int size;
+    unsigned int count;
+    unsigned error:1;
+  } driverCodes;
 };
 
 static int
@@ -1535,40 +1543,45 @@ usbGetChannelParameters (const char *identifier) {
   return getDeviceParameters(names, identifier);
 }
 
+static int
+usbParseChannelParameters (UsbChooseChannelData *data, char **parameters) {
+  int ok = 1;
+
+  data->serialNumber = parameters[USB_CHAN_SERIAL_NUMBER];
+  if (!usbParseVendorIdentifier(&data->vendorIdentifier, parameters[USB_CHAN_VENDOR_IDENTIFIER])) ok = 0;
+  if (!usbParseProductIdentifier(&data->productIdentifier, parameters[USB_CHAN_PRODUCT_IDENTIFIER])) ok = 0;
+
+  {
+    const char *parameter = parameters[USB_CHAN_GENERIC_DEVICES];
+
+    if (!(parameter && *parameter)) {
+      data->genericDevices = 1;
+    } else {
+      unsigned int flag;
+
+      if (validateYesNo(&flag, parameter)) {
+        data->genericDevices = flag;
+      } else {
+        logMessage(LOG_WARNING, "invalid generic devices option: %s", parameter);
+        ok = 0;
+      }
+    }
+  }
+
+  return ok;
+}
+
 UsbChannel *
 usbOpenChannel (const UsbChannelDefinition *definitions, const char *identifier) {
   UsbChannel *channel = NULL;
   char **parameters = usbGetChannelParameters(identifier);
 
   if (parameters) {
-    int ok = 1;
-
     UsbChooseChannelData choose = {
-      .definition = definitions,
-      .serialNumber = parameters[USB_CHAN_SERIAL_NUMBER]
+      .definition = definitions
     };
 
-    if (!usbParseVendorIdentifier(&choose.vendorIdentifier, parameters[USB_CHAN_VENDOR_IDENTIFIER])) ok = 0;
-    if (!usbParseProductIdentifier(&choose.productIdentifier, parameters[USB_CHAN_PRODUCT_IDENTIFIER])) ok = 0;
-
-    {
-      const char *parameter = parameters[USB_CHAN_GENERIC_DEVICES];
-
-      if (!(parameter && *parameter)) {
-        choose.genericDevices = 1;
-      } else {
-        unsigned int flag;
-
-        if (validateYesNo(&flag, parameter)) {
-          choose.genericDevices = flag;
-        } else {
-          logMessage(LOG_WARNING, "invalid generic devices option: %s", parameter);
-          ok = 0;
-        }
-      }
-    }
-
-    if (ok) {
+    if (usbParseChannelParameters(&choose, parameters)) {
       if (!(channel = usbNewChannel(&choose))) {
         logMessage(LOG_CATEGORY(USB_IO), "device not found%s%s",
                    (*identifier? ": ": ""), identifier);
@@ -1595,6 +1608,123 @@ usbCloseChannel (UsbChannel *channel) {
   free(channel);
 }
 
+static int
+usbSearchDeviceEntry (const void *target, const void *element) {
+  const UsbDeviceEntry *entry1 = target;
+  const UsbDeviceEntry *entry2 = element;
+
+  if (entry1->vendor < entry2->vendor) return -1;
+  if (entry1->vendor > entry2->vendor) return 1;
+
+  if (entry1->product < entry2->product) return -1;
+  if (entry1->product > entry2->product) return 1;
+
+  return 0;
+}
+
+static int
+usbAddDriverCode (UsbChooseChannelData *data, const char *code) {
+  for (unsigned int index=0; index<data->driverCodes.count; index+=1) {
+    if (strcmp(data->driverCodes.array[index], code) == 0) return 1;
+  }
+
+  /* leave room for the terminating NULL */
+  if (data->driverCodes.count == data->driverCodes.size) {
+    unsigned int newSize = data->driverCodes.size? data->driverCodes.size<<1: 0X8;
+    const char **newArray = realloc(data->driverCodes.array, ARRAY_SIZE(newArray, (newSize + 1)));
+
+    if (!newArray) {
+      logMallocError();
+      return 0;
+    }
+
+    data->driverCodes.array = newArray;
+    data->driverCodes.size = newSize;
+  }
+
+  data->driverCodes.array[data->driverCodes.count++] = code;
+  return 1;
+}
+
+static int
+usbChooseDriverCodes (UsbDevice *device, UsbChooseChannelData *data) {
+  /* Every connected device is checked (so this never chooses one) because
+   * a braille display may be connected along with another indexed device,
+   * e.g. a generic serial adapter, which some other driver claims.
+   */
+  const UsbDeviceDescriptor *descriptor = &device->descriptor;
+  const UsbDeviceEntry *entry;
+
+  {
+    const UsbDeviceEntry target = {
+      .vendor = getLittleEndian16(descriptor->idVendor),
+      .product = getLittleEndian16(descriptor->idProduct)
+    };
+
+    /* the table is generated in sorted order */
+    if (!(entry = bsearch(&target, usbDeviceTable, usbDeviceCount,
+                          sizeof(*usbDeviceTable), usbSearchDeviceEntry))) {
+      return 0;
+    }
+  }
+
+  if (!data->genericDevices) {
+    const UsbSerialAdapter *adapter = usbFindSerialAdapter(descriptor);
+    if (adapter && adapter->generic) return 0;
+  }
+
+  if (!usbVerifyVendorIdentifier(descriptor, data->vendorIdentifier)) return 0;
+  if (!usbVerifyProductIdentifier(descriptor, data->productIdentifier)) return 0;
+  if (!usbVerifySerialNumber(device, data->serialNumber)) return 0;
+
+  logMessage(LOG_CATEGORY(USB_IO), "indexed device: %04X:%04X",
+             entry->vendor, entry->product);
+
+  if (!data->driverCodes.error) {
+    const char *const *code = entry->driverCodes;
+
+    while (*code) {
+      if (!usbAddDriverCode(data, *code)) {
+        data->driverCodes.error = 1;
+        break;
+      }
+
+      code += 1;
+    }
+  }
+
+  return 0;
+}
+
+const char **
+usbGetDriverCodes (const char *identifier) {
+  const char **codes = NULL;
+  char **parameters = usbGetChannelParameters(identifier);
+
+  if (parameters) {
+    UsbChooseChannelData choose = {
+      .definition = NULL
+    };
+
+    if (usbParseChannelParameters(&choose, parameters)) {
+      UsbDevice *device = usbFindDevice(usbChooseDriverCodes, &choose);
+
+      if (device) usbCloseDevice(device);
+
+      if (choose.driverCodes.error) {
+        free(choose.driverCodes.array);
+      } else if (choose.driverCodes.count) {
+        codes = choose.driverCodes.array;
+        codes[choose.driverCodes.count] = NULL;
+      }
+    }
+
+    deallocateStrings(parameters);
+  }
+
+  return codes;
+}
+
 int
 isUsbDevice (const char **identifier) {
   return isQualifiedDevice(identifier, "usb");
@@ -85,6 +85,15 @@ struct UsbDeviceStruct {
   unsigned disableEndpointReset:1;
 };
 
+typedef struct {
+  uint16_t vendor;
+  uint16_t product;
+  const char *const *driverCodes;
+} UsbDeviceEntry;
+
+extern const UsbDeviceEntry usbDeviceTable[];
+extern const size_t usbDeviceCount;
+
 extern UsbDevice *usbTestDevice (
   UsbDeviceExtension *extension,
   UsbDeviceChooser *chooser,